@@ -0,0 +1,250 @@
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "nes.h"
+#include "cartridge.h"
+#include "profile.h"
+#include "perf_counter.h"
+#include "synth_rom.h"
+
+using namespace nes;
+
+// End-to-end throughput of NES::UpdateFrame() for nestest.nes and a
+// synthetic ROM per mapper. Results are written to stdout as JSON,
+// a summary goes to stderr.
+
+struct BenchResult {
+    std::string name;
+    int mapper_id = 0;
+    uint64_t frames = 0;
+    double seconds = 0;
+    double profiled_seconds = 0;
+    FrameProfile prof;
+    FrameProfile perf_prof;
+};
+
+static double elapsed_since(std::chrono::steady_clock::time_point start)
+{
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static void run_bench(Cartridge &cart, uint64_t warmup, uint64_t frames,
+        const PerfCounter *perf, BenchResult &result)
+{
+    NES nes;
+    nes.InsertCartridge(&cart);
+    nes.PowerUp();
+
+    for (uint64_t i = 0; i < warmup; i++)
+        nes.UpdateFrame();
+
+    // clean pass for frames/sec
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < frames; i++)
+        nes.UpdateFrame();
+    result.seconds = elapsed_since(start);
+
+    // profiled pass for the breakdown
+    const auto prof_start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < frames; i++)
+        nes.UpdateFrame(result.prof);
+    result.profiled_seconds = elapsed_since(prof_start);
+
+    // hardware counters pass. reading them makes ticks unreliable
+    if (perf) {
+        result.perf_prof.perf = perf;
+        for (uint64_t i = 0; i < frames; i++)
+            nes.UpdateFrame(result.perf_prof);
+    }
+
+    result.mapper_id = cart.GetMapperID();
+    result.frames = frames;
+
+    nes.ShutDown();
+}
+
+static void print_counters_json(const FrameProfile &prof)
+{
+    if (!prof.perf || prof.frames == 0) {
+        printf("      \"counters\": null\n");
+        return;
+    }
+
+    const double frames = static_cast<double>(prof.frames);
+
+    printf("      \"counters\": {\n");
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        const PerfSample &ev = prof.events[phase];
+        const double cycles = ev.values[PERF_CYCLES];
+        const double instructions = ev.values[PERF_INSTRUCTIONS];
+
+        printf("        \"%s\": {", GetPhaseName(phase));
+        for (int event = 0; event < PERF_EVENT_COUNT; event++) {
+            if (prof.perf->IsAvailable(event))
+                printf("\"%s_per_frame\": %.1f, ", GetPerfEventName(event),
+                        ev.values[event] / frames);
+            else
+                printf("\"%s_per_frame\": null, ", GetPerfEventName(event));
+        }
+        printf("\"ipc\": %.3f}%s\n", cycles > 0 ? instructions / cycles : 0.,
+                phase < PHASE_COUNT - 1 ? "," : "");
+    }
+    printf("      }\n");
+}
+
+static void print_json(const std::vector<BenchResult> &results, uint64_t frames)
+{
+    const double ns_per_tick = 1e9 / GetProfileTicksPerSecond();
+
+    printf("{\n");
+    printf("  \"frames\": %llu,\n", static_cast<unsigned long long>(frames));
+    printf("  \"roms\": [\n");
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        const FrameProfile &prof = r.prof;
+        const double cycles_per_frame = prof.frames ?
+            static_cast<double>(prof.cpu_cycles) / prof.frames : 0;
+
+        uint64_t total_ticks = 0;
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+            total_ticks += prof.ticks[phase];
+
+        printf("    {\n");
+        printf("      \"name\": \"%s\",\n", r.name.c_str());
+        printf("      \"mapper\": %d,\n", r.mapper_id);
+        printf("      \"frames\": %llu,\n", static_cast<unsigned long long>(r.frames));
+        printf("      \"seconds\": %.6f,\n", r.seconds);
+        printf("      \"fps\": %.2f,\n", r.frames / r.seconds);
+        printf("      \"cpu_cycles_per_frame\": %.1f,\n", cycles_per_frame);
+        printf("      \"ns_per_cpu_cycle\": %.3f,\n",
+                r.seconds * 1e9 / (r.frames * cycles_per_frame));
+        printf("      \"profile_overhead\": %.3f,\n", r.profiled_seconds / r.seconds);
+        printf("      \"phases\": {\n");
+
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            const uint64_t ticks = prof.ticks[phase];
+            printf("        \"%s\": {\"ns_per_frame\": %.1f, \"share\": %.4f}%s\n",
+                    GetPhaseName(phase),
+                    ticks * ns_per_tick / prof.frames,
+                    total_ticks ? static_cast<double>(ticks) / total_ticks : 0.,
+                    phase < PHASE_COUNT - 1 ? "," : "");
+        }
+
+        printf("      },\n");
+        print_counters_json(r.perf_prof);
+        printf("    }%s\n", i < results.size() - 1 ? "," : "");
+    }
+
+    printf("  ]\n");
+    printf("}\n");
+}
+
+static void print_summary(const BenchResult &r)
+{
+    const FrameProfile &prof = r.prof;
+
+    uint64_t total_ticks = 0;
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+        total_ticks += prof.ticks[phase];
+
+    fprintf(stderr, "%-20s %8.1f fps ", r.name.c_str(), r.frames / r.seconds);
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        fprintf(stderr, " %s %4.1f%%", GetPhaseName(phase),
+                total_ticks ? 100. * prof.ticks[phase] / total_ticks : 0.);
+    }
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t frames = 300;
+    uint64_t warmup = 60;
+    bool use_synth = true;
+    bool use_perf = false;
+    std::vector<std::string> filenames;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (arg == "--frames" && i + 1 < argc) {
+            frames = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--warmup" && i + 1 < argc) {
+            warmup = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--perf") {
+            use_perf = true;
+        }
+        else if (arg == "--no-synth") {
+            use_synth = false;
+        }
+        else if (arg[0] != '-') {
+            filenames.push_back(arg);
+        }
+        else {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    if (frames == 0) {
+        std::cerr << "frames must be greater than 0" << std::endl;
+        return -1;
+    }
+
+    PerfCounter perf;
+    if (use_perf && !perf.Open())
+        std::cerr << "hardware performance counters are not available" << std::endl;
+
+    const PerfCounter *counter = perf.IsOpen() ? &perf : nullptr;
+    std::vector<BenchResult> results;
+
+    for (const auto &filename: filenames) {
+        Cartridge cart;
+        if (!cart.Open(filename.c_str()) || !cart.IsMapperSupported()) {
+            std::cerr << filename << ": could not open rom" << std::endl;
+            return -1;
+        }
+
+        BenchResult result;
+        const size_t slash = filename.find_last_of('/');
+        result.name = slash == std::string::npos ? filename : filename.substr(slash + 1);
+
+        run_bench(cart, warmup, frames, counter, result);
+        print_summary(result);
+        results.push_back(result);
+    }
+
+    if (use_synth) {
+        for (const auto mapper_id: SYNTH_MAPPERS) {
+            const std::vector<uint8_t> rom = MakeSynthRom(mapper_id);
+            std::istringstream iss(std::string(rom.begin(), rom.end()));
+
+            Cartridge cart;
+            if (!cart.Open(iss) || !cart.IsMapperSupported()) {
+                std::cerr << "mapper " << mapper_id << ": could not make rom" << std::endl;
+                return -1;
+            }
+
+            char name[32] = {'\0'};
+            sprintf(name, "synth_mapper_%03d", mapper_id);
+
+            BenchResult result;
+            result.name = name;
+
+            run_bench(cart, warmup, frames, counter, result);
+            print_summary(result);
+            results.push_back(result);
+        }
+    }
+
+    print_json(results, frames);
+
+    return 0;
+}
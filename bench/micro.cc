@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "nes.h"
+#include "cartridge.h"
+#include "instruction.h"
+#include "synth_rom.h"
+
+using namespace nes;
+
+// Micro-benchmarks of single components in isolation
+//   cpu: CPU::Run() per opcode in instruction_table.h
+//   ppu: PPU::Clock() per scanline type with rendering on and off
+//   apu: APU::Clock() per enabled channel
+// Each measurement is repeated and reported as median and p99.
+
+struct Stats {
+    double median = 0;
+    double p99 = 0;
+};
+
+static Stats get_stats(std::vector<double> &samples)
+{
+    Stats stats;
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+
+    const size_t N = samples.size();
+    stats.median = samples[N / 2];
+    stats.p99 = samples[std::min(N - 1, N * 99 / 100)];
+
+    return stats;
+}
+
+static double elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+static bool open_rom(Cartridge &cart, const std::vector<uint8_t> &rom)
+{
+    std::istringstream iss(std::string(rom.begin(), rom.end()));
+    return cart.Open(iss) && cart.IsMapperSupported();
+}
+
+// --------------------------------------------------------------------------
+// cpu
+//
+// NROM image whose body at $8100 repeats one instruction. The prologue at
+// $8000 fills the stack page with $81 so RTS and RTI return into the body.
+// JMP, JSR, BRK and interrupts go back to the top of the body.
+static constexpr uint16_t BODY = 0x8100;
+static constexpr uint16_t BODY_END = 0xFFF0;
+static constexpr int INSTRUCTIONS_PER_SAMPLE = 4096;
+
+static std::vector<uint8_t> make_opcode_rom(uint8_t opcode)
+{
+    const Instruction inst = Decode(opcode);
+    std::vector<uint8_t> prg(0x8000, 0x00);
+
+    const uint8_t prologue[] = {
+        0xA2, 0x00,         // LDX #$00
+        0xA9, 0x81,         // LDA #$81
+        0x9D, 0x00, 0x01,   // STA $0100,X
+        0xE8,               // INX
+        0xD0, 0xFA,         // BNE -6
+        0x4C, 0x00, 0x81    // JMP $8100
+    };
+    std::copy(prologue, prologue + sizeof(prologue), prg.begin());
+
+    // operands point to RAM, or back to the body for jumps
+    uint16_t operand = 0x0010;
+    if (inst.addr_mode == IND)
+        operand = BODY_END;
+    else if (inst.operation == JMP || inst.operation == JSR)
+        operand = BODY;
+    else if (inst.addr_mode == ABS || inst.addr_mode == ABX || inst.addr_mode == ABY)
+        operand = 0x0200;
+    else if (inst.addr_mode == REL)
+        operand = 0x0000;
+
+    for (int addr = BODY; addr + inst.bytes <= BODY_END; addr += inst.bytes) {
+        const int i = addr - 0x8000;
+        prg[i] = opcode;
+        if (inst.bytes > 1)
+            prg[i + 1] = operand & 0xFF;
+        if (inst.bytes > 2)
+            prg[i + 2] = operand >> 8;
+    }
+
+    // indirect jump pointer
+    prg[BODY_END - 0x8000 + 0] = BODY & 0xFF;
+    prg[BODY_END - 0x8000 + 1] = BODY >> 8;
+
+    // vectors
+    const uint16_t vectors[] = {BODY, 0x8000, BODY};
+    for (int i = 0; i < 3; i++) {
+        prg[0x7FFA + i * 2 + 0] = vectors[i] & 0xFF;
+        prg[0x7FFA + i * 2 + 1] = vectors[i] >> 8;
+    }
+
+    std::vector<uint8_t> ines = {
+        'N', 'E', 'S', 0x1A, 2, 1, 0x01, 0x00,
+        0, 0, 0, 0, 0, 0, 0, 0
+    };
+    ines.insert(ines.end(), prg.begin(), prg.end());
+    ines.resize(ines.size() + 0x2000, 0x00);
+
+    return ines;
+}
+
+static void bench_cpu(int repeat)
+{
+    printf("%-6s %-4s %-4s %6s %12s %12s %12s\n",
+            "opcode", "op", "mode", "cycles", "median ns", "p99 ns", "ns/cycle");
+
+    for (int code = 0; code < 256; code++) {
+        const Instruction inst = Decode(code);
+        if (inst.operation == ILL)
+            continue;
+
+        Cartridge cart;
+        if (!open_rom(cart, make_opcode_rom(code)))
+            continue;
+
+        NES nes;
+        nes.InsertCartridge(&cart);
+        nes.PowerUp();
+
+        for (int i = 0; i < 10000 && nes.cpu.GetPC() != BODY; i++)
+            nes.cpu.Run();
+
+        std::vector<double> samples;
+        uint64_t cycles = 0;
+
+        // the first sample is warm-up
+        for (int r = 0; r < repeat + 1; r++) {
+            nes.cpu.SetPC(BODY);
+            const uint64_t cycles0 = nes.cpu.GetTotalCycles();
+            const auto start = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < INSTRUCTIONS_PER_SAMPLE; i++)
+                nes.cpu.Run();
+
+            const double ns = elapsed_ns(start);
+            if (r == 0)
+                continue;
+
+            samples.push_back(ns / INSTRUCTIONS_PER_SAMPLE);
+            cycles += nes.cpu.GetTotalCycles() - cycles0;
+        }
+
+        const Stats stats = get_stats(samples);
+        const double cycles_per_inst =
+            static_cast<double>(cycles) / (repeat * INSTRUCTIONS_PER_SAMPLE);
+
+        printf("$%02X    %-4s %-4s %6.2f %12.2f %12.2f %12.2f\n",
+                code,
+                GetOperationName(inst.operation),
+                GetAddressingModeName(inst.addr_mode),
+                cycles_per_inst,
+                stats.median,
+                stats.p99,
+                stats.median / cycles_per_inst);
+    }
+}
+
+// --------------------------------------------------------------------------
+// ppu
+enum ScanlineType {
+    LINE_VISIBLE = 0,
+    LINE_POST_RENDER,
+    LINE_VBLANK,
+    LINE_PRE_RENDER,
+    LINE_TYPE_COUNT
+};
+
+static ScanlineType get_scanline_type(int scanline)
+{
+    if (scanline >= 0 && scanline <= 239)
+        return LINE_VISIBLE;
+    else if (scanline == 240)
+        return LINE_POST_RENDER;
+    else if (scanline == 261)
+        return LINE_PRE_RENDER;
+    else
+        return LINE_VBLANK;
+}
+
+static void bench_ppu(int repeat)
+{
+    const char *type_names[] = {"visible", "post-render", "vblank", "pre-render"};
+
+    printf("%-12s %-9s %12s %12s %12s\n",
+            "scanline", "rendering", "median ns", "p99 ns", "ns/dot");
+
+    for (int rendering = 1; rendering >= 0; rendering--) {
+        Cartridge cart;
+        if (!open_rom(cart, MakeSynthRom(0)))
+            return;
+
+        NES nes;
+        nes.InsertCartridge(&cart);
+        nes.PowerUp();
+
+        PPU &ppu = nes.ppu;
+
+        // palette, name tables and 64 sprites
+        ppu.WriteAddress(0x3F);
+        ppu.WriteAddress(0x00);
+        for (int i = 0; i < 32; i++)
+            ppu.WriteData(i);
+        ppu.WriteAddress(0x20);
+        ppu.WriteAddress(0x00);
+        for (int i = 0; i < 2048; i++)
+            ppu.WriteData(i);
+        ppu.WriteOamAddress(0x00);
+        for (int i = 0; i < 256; i++)
+            ppu.WriteOamData(i);
+
+        ppu.WriteControl(0x10);
+        ppu.WriteMask(rendering ? 0x1E : 0x00);
+
+        std::vector<double> samples[LINE_TYPE_COUNT];
+        const int warmup = 262;
+        const int lines = warmup + repeat * 262;
+
+        for (int i = 0; i < lines; i++) {
+            const int scanline = ppu.GetScanline();
+            const auto start = std::chrono::steady_clock::now();
+
+            while (ppu.GetScanline() == scanline) {
+                ppu.Clock();
+            }
+
+            const double ns = elapsed_ns(start);
+            if (i < warmup)
+                continue;
+
+            samples[get_scanline_type(scanline)].push_back(ns);
+        }
+
+        for (int type = 0; type < LINE_TYPE_COUNT; type++) {
+            const Stats stats = get_stats(samples[type]);
+            printf("%-12s %-9s %12.1f %12.1f %12.2f\n",
+                    type_names[type],
+                    rendering ? "on" : "off",
+                    stats.median,
+                    stats.p99,
+                    stats.median / 341);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+// apu
+static void start_channels(APU &apu, uint8_t chan_bits)
+{
+    apu.WriteStatus(chan_bits);
+    apu.WriteFrameCounter(0x40);
+
+    // constant volume, length counters halted
+    apu.WriteSquare1Volume(0xBF);
+    apu.WriteSquare1Lo(0xFD);
+    apu.WriteSquare1Hi(0x08);
+    apu.WriteSquare2Volume(0x7F);
+    apu.WriteSquare2Lo(0xA0);
+    apu.WriteSquare2Hi(0x09);
+    apu.WriteTriangleLinear(0xFF);
+    apu.WriteTriangleLo(0x80);
+    apu.WriteTriangleHi(0x08);
+    apu.WriteNoiseVolume(0x3F);
+    apu.WriteNoiseLo(0x04);
+    apu.WriteNoiseHi(0x08);
+    // DMC loops over $C000-$C100
+    apu.WriteDmcFrequency(0x4F);
+    apu.WriteDmcSampleAddress(0x00);
+    apu.WriteDmcSampleLength(0x10);
+    apu.WriteStatus(chan_bits);
+}
+
+static void bench_apu(int repeat)
+{
+    const struct {
+        const char *name;
+        uint8_t chan_bits;
+    } channels[] = {
+        {"none",     0x00},
+        {"pulse1",   0x01},
+        {"pulse2",   0x02},
+        {"triangle", 0x04},
+        {"noise",    0x08},
+        {"dmc",      0x10},
+        {"all",      0x1F},
+    };
+    // about one frame of CPU cycles
+    const int CLOCKS_PER_SAMPLE = 29781;
+
+    printf("%-12s %12s %12s\n", "channel", "median ns", "p99 ns");
+
+    for (const auto &chan: channels) {
+        Cartridge cart;
+        if (!open_rom(cart, MakeSynthRom(0)))
+            return;
+
+        NES nes;
+        nes.InsertCartridge(&cart);
+        nes.PowerUp();
+
+        APU &apu = nes.apu;
+        start_channels(apu, chan.chan_bits);
+
+        std::vector<double> samples;
+
+        for (int r = 0; r < repeat + 1; r++) {
+            const auto start = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < CLOCKS_PER_SAMPLE; i++)
+                apu.Clock();
+
+            const double ns = elapsed_ns(start);
+            if (r == 0)
+                continue;
+
+            samples.push_back(ns / CLOCKS_PER_SAMPLE);
+        }
+
+        const Stats stats = get_stats(samples);
+        printf("%-12s %12.2f %12.2f\n", chan.name, stats.median, stats.p99);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int repeat = 101;
+    bool run_cpu = false;
+    bool run_ppu = false;
+    bool run_apu = false;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (arg == "cpu") {
+            run_cpu = true;
+        }
+        else if (arg == "ppu") {
+            run_ppu = true;
+        }
+        else if (arg == "apu") {
+            run_apu = true;
+        }
+        else {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    if (!run_cpu && !run_ppu && !run_apu)
+        run_cpu = run_ppu = run_apu = true;
+
+    if (run_cpu) {
+        bench_cpu(repeat);
+        printf("\n");
+    }
+    if (run_ppu) {
+        bench_ppu(repeat);
+        printf("\n");
+    }
+    if (run_apu) {
+        bench_apu(repeat);
+    }
+
+    return 0;
+}
@@ -0,0 +1,444 @@
+#include <algorithm>
+#include "synth_rom.h"
+
+namespace nes {
+
+const std::vector<int> SYNTH_MAPPERS = {0, 1, 2, 3, 4, 10, 16, 19, 76};
+
+// 6502 opcodes used by the program
+enum Opcode : uint8_t {
+    ADC_ZPG = 0x65,
+    BIT_ABS = 0x2C,
+    BNE     = 0xD0,
+    BPL     = 0x10,
+    CLC     = 0x18,
+    CLD     = 0xD8,
+    CLI     = 0x58,
+    CPX_IMM = 0xE0,
+    DEX     = 0xCA,
+    DEY     = 0x88,
+    INC_ZPG = 0xE6,
+    INX     = 0xE8,
+    JMP_ABS = 0x4C,
+    LDA_ABS = 0xAD,
+    LDA_ABX = 0xBD,
+    LDA_IMM = 0xA9,
+    LDA_ZPG = 0xA5,
+    LDX_IMM = 0xA2,
+    LDY_IMM = 0xA0,
+    LSR_ACC = 0x4A,
+    NOP     = 0xEA,
+    PHA     = 0x48,
+    PLA     = 0x68,
+    RTI     = 0x40,
+    SEI     = 0x78,
+    STA_ABS = 0x8D,
+    STA_ABX = 0x9D,
+    STX_ABS = 0x8E,
+    STX_ZPG = 0x86,
+    TAX     = 0xAA,
+    TAY     = 0xA8,
+    TXA     = 0x8A,
+    TXS     = 0x9A,
+    TYA     = 0x98,
+};
+
+// zero page variables
+static constexpr uint8_t ZP_COUNTER = 0x10;
+static constexpr uint8_t ZP_FRAME   = 0x11;
+static constexpr uint8_t ZP_IRQ_X   = 0x12;
+
+// the program lives in the last 8KB, which every mapper fixes at power-up
+static constexpr uint16_t ORIGIN = 0xE000;
+
+class Program {
+public:
+    uint16_t Here() const
+    {
+        return ORIGIN + static_cast<uint16_t>(code_.size());
+    }
+
+    void Op(uint8_t op)
+    {
+        code_.push_back(op);
+    }
+
+    void Op8(uint8_t op, uint8_t arg)
+    {
+        code_.push_back(op);
+        code_.push_back(arg);
+    }
+
+    void Op16(uint8_t op, uint16_t arg)
+    {
+        code_.push_back(op);
+        code_.push_back(arg & 0xFF);
+        code_.push_back(arg >> 8);
+    }
+
+    // backward branches only
+    void Branch(uint8_t op, uint16_t target)
+    {
+        const int offset = target - (Here() + 2);
+        Op8(op, static_cast<uint8_t>(offset));
+    }
+
+    void Store(uint16_t addr, uint8_t data)
+    {
+        Op8(LDA_IMM, data);
+        Op16(STA_ABS, addr);
+    }
+
+    const std::vector<uint8_t> &Code() const
+    {
+        return code_;
+    }
+
+private:
+    std::vector<uint8_t> code_;
+};
+
+struct RomLayout {
+    int prg_size;
+    int chr_size;
+    bool has_irq;
+};
+
+static bool get_layout(int mapper_id, RomLayout &layout)
+{
+    const int KB = 1024;
+
+    switch (mapper_id) {
+    case 0:  layout = {32 * KB,  8 * KB,   false}; return true;
+    case 1:  layout = {128 * KB, 128 * KB, false}; return true;
+    case 2:  layout = {128 * KB, 0,        false}; return true;
+    case 3:  layout = {32 * KB,  32 * KB,  false}; return true;
+    case 4:  layout = {128 * KB, 128 * KB, true};  return true;
+    case 10: layout = {128 * KB, 128 * KB, false}; return true;
+    case 16: layout = {128 * KB, 128 * KB, true};  return true;
+    case 19: layout = {128 * KB, 128 * KB, true};  return true;
+    case 76: layout = {128 * KB, 128 * KB, false}; return true;
+    default: return false;
+    }
+}
+
+// switches banks by the value in A. may destroy A and X
+static void emit_bank_switch(Program &p, int mapper_id)
+{
+    switch (mapper_id) {
+    case 1:
+        // 5 serial writes, LSB first
+        for (int i = 0; i < 5; i++) {
+            p.Op16(STA_ABS, 0xE000);
+            p.Op(LSR_ACC);
+        }
+        p.Op8(LDA_ZPG, ZP_COUNTER);
+        for (int i = 0; i < 5; i++) {
+            p.Op16(STA_ABS, 0xA000);
+            p.Op(LSR_ACC);
+        }
+        break;
+
+    case 2:
+    case 3:
+        p.Op16(STA_ABS, 0x8000);
+        break;
+
+    case 4:
+    case 76:
+        // R:6, R:7 PRG and R:2 CHR
+        p.Op8(LDX_IMM, 0x06);
+        p.Op16(STX_ABS, 0x8000);
+        p.Op16(STA_ABS, 0x8001);
+        p.Op8(LDX_IMM, 0x07);
+        p.Op16(STX_ABS, 0x8000);
+        p.Op16(STA_ABS, 0x8001);
+        p.Op8(LDX_IMM, 0x02);
+        p.Op16(STX_ABS, 0x8000);
+        p.Op16(STA_ABS, 0x8001);
+        break;
+
+    case 10:
+        p.Op16(STA_ABS, 0xA000);
+        p.Op16(STA_ABS, 0xB000);
+        p.Op16(STA_ABS, 0xC000);
+        break;
+
+    case 16:
+        p.Op16(STA_ABS, 0x8008);
+        p.Op16(STA_ABS, 0x8000);
+        break;
+
+    case 19:
+        p.Op16(STA_ABS, 0xE000);
+        p.Op16(STA_ABS, 0x8000);
+        break;
+
+    default:
+        break;
+    }
+}
+
+// starts the IRQ counter. also used as acknowledge in the handler
+static void emit_irq_start(Program &p, int mapper_id)
+{
+    switch (mapper_id) {
+    case 4:
+        // every 32 scanlines
+        p.Op8(LDA_IMM, 0x1F);
+        p.Op16(STA_ABS, 0xE000);
+        p.Op16(STA_ABS, 0xC000);
+        p.Op16(STA_ABS, 0xC001);
+        p.Op16(STA_ABS, 0xE001);
+        break;
+
+    case 16:
+        // every 0x4000 CPU cycles
+        p.Store(0x800B, 0x00);
+        p.Store(0x800C, 0x40);
+        p.Store(0x800A, 0x01);
+        break;
+
+    case 19:
+        // counts up from 0x4000 to 0x7FFF
+        p.Store(0x5000, 0x00);
+        p.Store(0x5800, 0xC0);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static std::vector<uint8_t> make_program(int mapper_id, const RomLayout &layout,
+        uint16_t &nmi, uint16_t &reset, uint16_t &irq)
+{
+    Program p;
+
+    // NMI: OAM DMA, scroll, read joypad
+    nmi = p.Here();
+    p.Op(PHA);
+    p.Op(TXA);
+    p.Op(PHA);
+    p.Op(TYA);
+    p.Op(PHA);
+    p.Store(0x4014, 0x02);
+    p.Op8(LDA_ZPG, ZP_COUNTER);
+    p.Op16(STA_ABS, 0x2005);
+    p.Store(0x2005, 0x00);
+    p.Store(0x4016, 0x01);
+    p.Store(0x4016, 0x00);
+    p.Op8(LDX_IMM, 0x08);
+    const uint16_t pad = p.Here();
+    p.Op16(LDA_ABS, 0x4016);
+    p.Op(DEX);
+    p.Branch(BNE, pad);
+    p.Op8(INC_ZPG, ZP_FRAME);
+    p.Op(PLA);
+    p.Op(TAY);
+    p.Op(PLA);
+    p.Op(TAX);
+    p.Op(PLA);
+    p.Op(RTI);
+
+    // IRQ: acknowledge and restart the counter. the APU frame IRQ is
+    // acknowledged by reading $4015. X is where the IRQ hit the main loop
+    irq = p.Here();
+    p.Op8(STX_ZPG, ZP_IRQ_X);
+    p.Op(PHA);
+    if (layout.has_irq)
+        emit_irq_start(p, mapper_id);
+    else
+        p.Op16(LDA_ABS, 0x4015);
+    p.Op(PLA);
+    p.Op(RTI);
+
+    // reset
+    reset = p.Here();
+    p.Op(SEI);
+    p.Op(CLD);
+    p.Op8(LDX_IMM, 0xFF);
+    p.Op(TXS);
+    p.Store(0x4017, 0x40);
+    p.Store(0x2000, 0x00);
+    p.Store(0x2001, 0x00);
+
+    for (int i = 0; i < 2; i++) {
+        const uint16_t vblank = p.Here();
+        p.Op16(BIT_ABS, 0x2002);
+        p.Branch(BPL, vblank);
+    }
+
+    // palette
+    p.Store(0x2006, 0x3F);
+    p.Store(0x2006, 0x00);
+    p.Op8(LDX_IMM, 0x00);
+    const uint16_t palette = p.Here();
+    p.Op(TXA);
+    p.Op16(STA_ABS, 0x2007);
+    p.Op(INX);
+    p.Op8(CPX_IMM, 0x20);
+    p.Branch(BNE, palette);
+
+    // name tables
+    p.Store(0x2006, 0x20);
+    p.Store(0x2006, 0x00);
+    p.Op8(LDY_IMM, 0x08);
+    p.Op8(LDX_IMM, 0x00);
+    const uint16_t name_table = p.Here();
+    p.Op(TXA);
+    p.Op16(STA_ABS, 0x2007);
+    p.Op(INX);
+    p.Branch(BNE, name_table);
+    p.Op(DEY);
+    p.Branch(BNE, name_table);
+
+    // sprites in OAM page $0200
+    p.Op8(LDX_IMM, 0x00);
+    const uint16_t sprite = p.Here();
+    p.Op(TXA);
+    p.Op16(STA_ABX, 0x0200);
+    p.Op(INX);
+    p.Branch(BNE, sprite);
+
+    // APU. all channels on, DMC loops over $C000
+    p.Store(0x4015, 0x1F);
+    p.Store(0x4000, 0xBF);
+    p.Store(0x4002, 0xFD);
+    p.Store(0x4003, 0x08);
+    p.Store(0x4004, 0x7F);
+    p.Store(0x4006, 0xA0);
+    p.Store(0x4007, 0x09);
+    p.Store(0x4008, 0xFF);
+    p.Store(0x400A, 0x80);
+    p.Store(0x400B, 0x08);
+    p.Store(0x400C, 0x3F);
+    p.Store(0x400E, 0x04);
+    p.Store(0x400F, 0x08);
+    p.Store(0x4010, 0x4F);
+    p.Store(0x4012, 0x00);
+    p.Store(0x4013, 0x10);
+
+    // rendering on with NMI
+    p.Store(0x2000, 0x90);
+    p.Store(0x2001, 0x1E);
+
+    // boards without an IRQ counter use the APU frame IRQ
+    if (layout.has_irq)
+        emit_irq_start(p, mapper_id);
+    else
+        p.Store(0x4017, 0x00);
+    p.Op(CLI);
+
+    // main loop
+    const uint16_t main_loop = p.Here();
+    p.Op8(INC_ZPG, ZP_COUNTER);
+    p.Op8(LDA_ZPG, ZP_COUNTER);
+    emit_bank_switch(p, mapper_id);
+    p.Op8(LDA_ZPG, ZP_COUNTER);
+    p.Op16(STA_ABS, 0x4002);
+
+    p.Op8(LDX_IMM, 0x00);
+    const uint16_t work = p.Here();
+    p.Op16(LDA_ABX, 0x0300);
+    p.Op(CLC);
+    p.Op8(ADC_ZPG, ZP_COUNTER);
+    p.Op16(STA_ABX, 0x0300);
+    p.Op(INX);
+    p.Branch(BNE, work);
+    p.Op16(JMP_ABS, main_loop);
+
+    return p.Code();
+}
+
+std::vector<uint8_t> MakeSynthRom(int mapper_id)
+{
+    RomLayout layout;
+    if (!get_layout(mapper_id, layout))
+        return std::vector<uint8_t>();
+
+    std::vector<uint8_t> prg(layout.prg_size);
+    std::vector<uint8_t> chr(layout.chr_size);
+
+    // data banks
+    for (int i = 0; i < layout.prg_size; i++)
+        prg[i] = static_cast<uint8_t>(i * 7 + (i >> 13));
+
+    // tiles from a linear congruential generator
+    uint32_t seed = 0x12345678 + mapper_id;
+    for (int i = 0; i < layout.chr_size; i++) {
+        seed = seed * 1103515245 + 12345;
+        chr[i] = static_cast<uint8_t>(seed >> 16);
+    }
+
+    uint16_t nmi = 0, reset = 0, irq = 0;
+    const std::vector<uint8_t> code = make_program(mapper_id, layout, nmi, reset, irq);
+
+    const int base = layout.prg_size - 0x2000;
+    std::copy(code.begin(), code.end(), prg.begin() + base);
+
+    const uint16_t vectors[] = {nmi, reset, irq};
+    for (int i = 0; i < 3; i++) {
+        prg[layout.prg_size - 6 + i * 2 + 0] = vectors[i] & 0xFF;
+        prg[layout.prg_size - 6 + i * 2 + 1] = vectors[i] >> 8;
+    }
+
+    // iNES header. vertical mirroring
+    std::vector<uint8_t> ines = {
+        'N', 'E', 'S', 0x1A,
+        static_cast<uint8_t>(layout.prg_size / 0x4000),
+        static_cast<uint8_t>(layout.chr_size / 0x2000),
+        static_cast<uint8_t>(((mapper_id & 0x0F) << 4) | 0x01),
+        static_cast<uint8_t>(mapper_id & 0xF0),
+        0, 0, 0, 0, 0, 0, 0, 0
+    };
+
+    ines.insert(ines.end(), prg.begin(), prg.end());
+    ines.insert(ines.end(), chr.begin(), chr.end());
+
+    return ines;
+}
+
+std::vector<uint8_t> MakePageEndRom()
+{
+    // $FFF0-$FFFC NOP, $FFFD LDA $EAEA. the vectors are part of the code:
+    //   NMI   $EAEA  never enabled
+    //   reset $ADEA
+    //   IRQ   $EAEA  operand of LDA, never enabled
+    const uint16_t loop = 0xFFF0;
+    const uint16_t reset = 0xADEA;
+    std::vector<uint8_t> prg(0x8000, NOP);
+    prg[0x7FFC] = reset & 0xFF;
+    prg[0x7FFD] = reset >> 8;
+
+    // $0000 16-bit counter at $10, JMP $FFF0. PC wraps to $0000 after $FFFF
+    const uint8_t ram_code[] = {
+        INC_ZPG, ZP_COUNTER,
+        BNE, 0x02,
+        INC_ZPG, ZP_COUNTER + 1,
+        JMP_ABS, loop & 0xFF, loop >> 8
+    };
+
+    Program p;
+    p.Op(SEI);
+    p.Op(CLD);
+    p.Op8(LDX_IMM, 0xFF);
+    p.Op(TXS);
+    for (int i = 0; i < static_cast<int>(sizeof(ram_code)); i++)
+        p.Store(i, ram_code[i]);
+    p.Op16(JMP_ABS, loop);
+
+    const std::vector<uint8_t> &code = p.Code();
+    std::copy(code.begin(), code.end(), prg.begin() + (reset - 0x8000));
+
+    std::vector<uint8_t> ines = {
+        'N', 'E', 'S', 0x1A, 2, 1, 0x01, 0x00,
+        0, 0, 0, 0, 0, 0, 0, 0
+    };
+    ines.insert(ines.end(), prg.begin(), prg.end());
+    ines.resize(ines.size() + 0x2000, 0x00);
+
+    return ines;
+}
+
+} // namespace
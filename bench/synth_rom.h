@@ -0,0 +1,25 @@
+#ifndef SYNTH_ROM_H
+#define SYNTH_ROM_H
+
+#include <cstdint>
+#include <vector>
+
+namespace nes {
+
+// Mapper ids that synthetic ROMs can be made for
+extern const std::vector<int> SYNTH_MAPPERS;
+
+// Builds an iNES image for the mapper. The program turns on rendering with
+// sprites, all APU channels and OAM DMA, switches PRG/CHR banks in its main
+// loop and uses the mapper IRQ if the board has one, else the APU frame IRQ.
+// Returns an empty image if the mapper is unknown.
+std::vector<uint8_t> MakeSynthRom(int mapper_id);
+
+// Builds an NROM image whose main loop runs the last page of PRG ROM up to
+// $FFFF, through the vectors, and returns from RAM. The 3-byte instruction at
+// $FFFD ends exactly at $FFFF. Counts the loops in $10-$11.
+std::vector<uint8_t> MakePageEndRom();
+
+} // namespace
+
+#endif // _H
@@ -0,0 +1,78 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "alloc_count.h"
+
+#if NES_ALLOC
+static std::atomic<uint64_t> alloc_count(0);
+
+static void *count_alloc(std::size_t size) noexcept
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new(std::size_t size)
+{
+    void *ptr = count_alloc(size);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](std::size_t size)
+{
+    void *ptr = count_alloc(size);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return count_alloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return count_alloc(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+namespace nes {
+
+bool IsAllocCountEnabled()
+{
+    return NES_ALLOC != 0;
+}
+
+uint64_t GetAllocCount()
+{
+#if NES_ALLOC
+    return alloc_count.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+} // namespace
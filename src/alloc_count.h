@@ -0,0 +1,24 @@
+#ifndef ALLOC_COUNT_H
+#define ALLOC_COUNT_H
+
+#include <cstdint>
+
+// Counts heap allocations to check that the emulation loop does not
+// allocate once it is running.
+//
+// Build with ALLOC=1 (make alloc builds nes-headless-alloc) to replace the
+// global operator new. With ALLOC=0 nothing is replaced or counted.
+#ifndef NES_ALLOC
+#define NES_ALLOC 0
+#endif
+
+namespace nes {
+
+// false if counting is not built in
+bool IsAllocCountEnabled();
+// allocations so far in all threads
+uint64_t GetAllocCount();
+
+} // namespace
+
+#endif // _H
@@ -1,8 +1,10 @@
 #include "apu.h"
 #include "sound.h"
+#include "hash.h"
 #include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <climits>
 
 namespace nes {
 
@@ -884,6 +886,9 @@ void APU::Clock()
         lpf += k * (raw_data - lpf);
 
         PushSample(lpf);
+
+        if (sample_hash_)
+            *sample_hash_ = HashBytes(&lpf, sizeof(lpf), *sample_hash_);
     }
 
     clock_++;
@@ -947,6 +952,19 @@ bool APU::IsSetIRQ() const
     return frame_interrupt_;
 }
 
+int APU::GetCyclesToIRQ() const
+{
+    // set at the last step of the 4 step sequence
+    const uint32_t LAST_STEP = 14915;
+
+    if (mode_ != 0 || inhibit_interrupt_ || cycle_ > LAST_STEP)
+        return INT_MAX;
+
+    // the sequencer is clocked every other cycle, on even clocks
+    const int steps = LAST_STEP - cycle_ + 1;
+    return 2 * steps - (clock_ % 2 == 0);
+}
+
 void APU::SetCPU(const CPU *cpu)
 {
     dmc_.cpu = cpu;
@@ -967,4 +985,9 @@ uint8_t APU::GetChannelEnable() const
     return chan_enable_;
 }
 
+void APU::SetSampleHash(uint64_t *hash)
+{
+    sample_hash_ = hash;
+}
+
 } // namespace
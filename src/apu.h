@@ -28,6 +28,17 @@ struct Sweep {
         SERIALIZE(ar, data, divider);
         SERIALIZE_NAMESPACE_END(ar);
     }
+
+    friend void HashState(StateHash &h, const Sweep *data)
+    {
+        HASH_STATE(h, data, enabled);
+        HASH_STATE(h, data, period);
+        HASH_STATE(h, data, target_period);
+        HASH_STATE(h, data, negate);
+        HASH_STATE(h, data, shift);
+        HASH_STATE(h, data, reload);
+        HASH_STATE(h, data, divider);
+    }
 };
 
 struct Envelope {
@@ -50,6 +61,16 @@ struct Envelope {
         SERIALIZE(ar, data, constant);
         SERIALIZE_NAMESPACE_END(ar);
     }
+
+    friend void HashState(StateHash &h, const Envelope *data)
+    {
+        HASH_STATE(h, data, start);
+        HASH_STATE(h, data, decay);
+        HASH_STATE(h, data, divider);
+        HASH_STATE(h, data, volume);
+        HASH_STATE(h, data, loop);
+        HASH_STATE(h, data, constant);
+    }
 };
 
 struct PulseChannel {
@@ -85,6 +106,19 @@ struct PulseChannel {
         SERIALIZE(ar, data, envelope);
         SERIALIZE_NAMESPACE_END(ar);
     }
+
+    friend void HashState(StateHash &h, const PulseChannel *data)
+    {
+        HASH_STATE(h, data, enabled);
+        HASH_STATE(h, data, timer);
+        HASH_STATE(h, data, timer_period);
+        HASH_STATE(h, data, length);
+        HASH_STATE(h, data, length_halt);
+        HASH_STATE(h, data, duty);
+        HASH_STATE(h, data, sequence_pos);
+        HASH_STATE(h, data, sweep);
+        HASH_STATE(h, data, envelope);
+    }
 };
 
 struct TriangleChannel {
@@ -126,6 +160,22 @@ struct TriangleChannel {
         SERIALIZE(ar, data, start_ramp);
         SERIALIZE_NAMESPACE_END(ar);
     }
+
+    friend void HashState(StateHash &h, const TriangleChannel *data)
+    {
+        HASH_STATE(h, data, enabled);
+        HASH_STATE(h, data, timer);
+        HASH_STATE(h, data, timer_period);
+        HASH_STATE(h, data, length);
+        HASH_STATE(h, data, length_halt);
+        HASH_STATE(h, data, control);
+        HASH_STATE(h, data, linear_counter);
+        HASH_STATE(h, data, linear_period);
+        HASH_STATE(h, data, linear_reload);
+        HASH_STATE(h, data, sequence_pos);
+        HASH_STATE(h, data, output_level);
+        HASH_STATE(h, data, start_ramp);
+    }
 };
 
 struct NoiseChannel {
@@ -157,6 +207,18 @@ struct NoiseChannel {
         SERIALIZE(ar, data, envelope);
         SERIALIZE_NAMESPACE_END(ar);
     }
+
+    friend void HashState(StateHash &h, const NoiseChannel *data)
+    {
+        HASH_STATE(h, data, enabled);
+        HASH_STATE(h, data, timer);
+        HASH_STATE(h, data, timer_period);
+        HASH_STATE(h, data, length);
+        HASH_STATE(h, data, length_halt);
+        HASH_STATE(h, data, shift);
+        HASH_STATE(h, data, mode);
+        HASH_STATE(h, data, envelope);
+    }
 };
 
 struct DmcChannel {
@@ -209,6 +271,26 @@ struct DmcChannel {
         SERIALIZE(ar, data, bits_counter);
         SERIALIZE_NAMESPACE_END(ar);
     }
+
+    friend void HashState(StateHash &h, const DmcChannel *data)
+    {
+        HASH_STATE(h, data, enabled);
+        HASH_STATE(h, data, timer);
+        HASH_STATE(h, data, timer_period);
+        HASH_STATE(h, data, irq_generated);
+        HASH_STATE(h, data, irq_enabled);
+        HASH_STATE(h, data, cpu_stall);
+        HASH_STATE(h, data, buffer_empty);
+        HASH_STATE(h, data, sample_buffer);
+        HASH_STATE(h, data, loop);
+        HASH_STATE(h, data, sample_address);
+        HASH_STATE(h, data, sample_length);
+        HASH_STATE(h, data, current_address);
+        HASH_STATE(h, data, bytes_remaining);
+        HASH_STATE(h, data, output_level);
+        HASH_STATE(h, data, shift_register);
+        HASH_STATE(h, data, bits_counter);
+    }
 };
 
 class APU {
@@ -224,6 +306,8 @@ public:
 
     // interrupts
     bool IsSetIRQ() const;
+    // CPU cycles until Run() sets the frame interrupt. INT_MAX if it can't
+    int GetCyclesToIRQ() const;
     // CPU
     void SetCPU(const CPU *cpu);
     void SetSpeedFactor(float factor);
@@ -262,6 +346,8 @@ public:
     // debug
     void SetChannelEnable(uint8_t chan_bits);
     uint8_t GetChannelEnable() const;
+    // every generated sample is hashed into *hash. nullptr to stop
+    void SetSampleHash(uint64_t *hash);
 
 private:
     float audio_time_ = 0.f;
@@ -283,6 +369,7 @@ private:
 
     // debug
     uint8_t chan_enable_ = 0x1F;
+    uint64_t *sample_hash_ = nullptr;
 
     // serialization
     friend void Serialize(Archive &ar, const std::string &name, APU *data)
@@ -304,6 +391,23 @@ private:
         SERIALIZE_NAMESPACE_END(ar);
     }
 
+    friend void HashState(StateHash &h, const APU *data)
+    {
+        HASH_STATE(h, data, audio_time_);
+        HASH_STATE(h, data, clock_);
+        HASH_STATE(h, data, cycle_);
+        HASH_STATE(h, data, mode_);
+        HASH_STATE(h, data, inhibit_interrupt_);
+        HASH_STATE(h, data, frame_interrupt_);
+        HASH_STATE(h, data, dmc_interrupt_);
+        HASH_STATE(h, data, low_pass_filter_);
+        HASH_STATE(h, data, pulse1_);
+        HASH_STATE(h, data, pulse2_);
+        HASH_STATE(h, data, triangle_);
+        HASH_STATE(h, data, noise_);
+        HASH_STATE(h, data, dmc_);
+    }
+
     void clock_timers();
     void clock_length_counters();
     void clock_sweeps();
@@ -1,6 +1,7 @@
 #ifndef BANK_MAP_H
 #define BANK_MAP_H
 
+#include <array>
 #include "serialize.h"
 
 namespace nes {
@@ -41,6 +42,26 @@ public:
             windows_[window_index] = bank_index % bank_count_;
     }
 
+    // host memory of the banks for data(). must outlive the map
+    void set_memory(const uint8_t *memory, int size)
+    {
+        memory_ = memory;
+        memory_size_ = size;
+    }
+
+    // pointer to the byte at addr in the selected bank, nullptr if the bank
+    // is outside of the memory. made from windows_ so it is never stale
+    const uint8_t *data(uint16_t addr) const
+    {
+        const int offset = addr % static_cast<int>(BANK_SIZE);
+        const int window = addr / static_cast<int>(BANK_SIZE);
+        const int base = windows_[window] * static_cast<int>(BANK_SIZE);
+
+        if (!memory_ || base < 0 || base + offset >= memory_size_)
+            return nullptr;
+        return memory_ + base + offset;
+    }
+
     int map(uint16_t addr) const
     {
         const int offset = addr % static_cast<int>(BANK_SIZE);
@@ -70,6 +91,8 @@ public:
 private:
     std::array<int,WINDOW_COUNT> windows_ = {0};
     int bank_count_ = 1;
+    const uint8_t *memory_ = nullptr;
+    int memory_size_ = 0;
 
     // serialization
     friend void Serialize(Archive &ar, const std::string &name,
@@ -80,18 +103,28 @@ private:
         SERIALIZE(ar, data, bank_count_);
         SERIALIZE_NAMESPACE_END(ar);
     }
+
+    friend void HashState(StateHash &h, const bank_map<BANK_SIZE, WINDOW_COUNT> *data)
+    {
+        HASH_STATE(h, data, windows_);
+        HASH_STATE(h, data, bank_count_);
+    }
 };
 
+// fixed size so it can be filled every frame without allocation
 struct BankInfo {
-    std::vector<int> selected;
-    int bank_count;
+    static constexpr int MAX_WINDOW_COUNT = 16;
+    std::array<int,MAX_WINDOW_COUNT> selected = {{0}};
+    int window_count = 0;
+    int bank_count = 0;
 };
 
 template<Size BANK_SIZE, int WINDOW_COUNT>
 void GetBankInfo(const bank_map<BANK_SIZE, WINDOW_COUNT> &map, BankInfo &info)
 {
+    static_assert(WINDOW_COUNT <= BankInfo::MAX_WINDOW_COUNT, "too many windows");
     const int N = map.window_count();
-    info.selected.resize(N);
+    info.window_count = N;
 
     for (int i = 0; i < N; i++) {
         info.selected[i] = map.bank(i);
@@ -103,7 +136,7 @@ void GetBankInfo(const bank_map<BANK_SIZE, WINDOW_COUNT> &map, BankInfo &info)
 inline
 void GetDefaultBankInfo(BankInfo &info)
 {
-    info.selected.resize(1);
+    info.window_count = 1;
     info.selected[0] = 0;
 
     info.bank_count = 1;
@@ -4,10 +4,10 @@
 
 namespace nes {
 
-static std::vector<uint8_t> read_data(std::ifstream &ifs, size_t count)
+static std::vector<uint8_t> read_data(std::istream &is, size_t count)
 {
     std::vector<uint8_t> data(count, 0);
-    ifs.read(reinterpret_cast<char*>(&data[0]), sizeof(data[0]) * count);
+    is.read(reinterpret_cast<char*>(&data[0]), sizeof(data[0]) * count);
     return data;
 }
 
@@ -32,10 +32,28 @@ bool Cartridge::Open(const char *filename)
         return false;
 
     ines_filename_ = filename;
+
+    if (!Open(ifs))
+        return false;
+
+    if (!IsMapperSupported())
+        // file is opened, mapper is not supported.
+        return true;
+
+    if (HasBattery()) {
+        sram_filename_ = ines_filename_ + ".sram";
+        load_battery_ram();
+    }
+
+    return true;
+}
+
+bool Cartridge::Open(std::istream &is)
+{
     char header[16] = {'\0'};
 
     // Bytes 0-3 Constant $4E $45 $53 $1A (ASCII "NES" followed by MS-DOS end-of-file)
-    ifs.read(header, sizeof(char) * 16);
+    is.read(header, sizeof(char) * 16);
     if (header[0] != 'N' ||
         header[1] != 'E' ||
         header[2] != 'S' ||
@@ -71,8 +89,8 @@ bool Cartridge::Open(const char *filename)
     // ++++----- Upper nybble of mapper number
     mapper_id_ |= header[7] & 0xF0;
 
-    const std::vector<uint8_t> prg_data = read_data(ifs, prg_size);
-    const std::vector<uint8_t> chr_data = read_data(ifs, chr_size);
+    const std::vector<uint8_t> prg_data = read_data(is, prg_size);
+    const std::vector<uint8_t> chr_data = read_data(is, chr_size);
 
     mapper_ = new_mapper(mapper_id_, prg_data, chr_data);
     if (!IsMapperSupported())
@@ -84,11 +102,6 @@ bool Cartridge::Open(const char *filename)
     else if (mirroring_ == 1)
         mapper_->SetMirroring(MIRRORING_VERTICAL);
 
-    if (HasBattery()) {
-        sram_filename_ = ines_filename_ + ".sram";
-        load_battery_ram();
-    }
-
     return true;
 }
 
@@ -127,6 +140,11 @@ uint8_t Cartridge::PeekPrg(uint32_t physical_addr) const
     return mapper_->PeekPrg(physical_addr);
 }
 
+const uint8_t *Cartridge::GetPrgRomData(uint16_t addr) const
+{
+    return mapper_->GetPrgRomData(addr);
+}
+
 int Cartridge::GetMapperID() const
 {
     return mapper_id_;
@@ -151,15 +169,16 @@ void Cartridge::GetCartridgeStatus(CartridgeStatus &stat) const
     stat.prg_size = GetPrgSize();
     stat.chr_size = GetChrSize();
 
-    BankInfo info;
+    mapper_->GetPrgBankInfo(stat.prg_banks);
+    stat.prg_bank_count = stat.prg_banks.bank_count;
 
-    mapper_->GetPrgBankInfo(info);
-    stat.prg_bank_count = info.bank_count;
-    stat.prg_selected = info.selected;
+    mapper_->GetChrBankInfo(stat.chr_banks);
+    stat.chr_bank_count = stat.chr_banks.bank_count;
+}
 
-    mapper_->GetChrBankInfo(info);
-    stat.chr_bank_count = info.bank_count;
-    stat.chr_selected = info.selected;
+void Cartridge::GetPrgBankInfo(BankInfo &info) const
+{
+    mapper_->GetPrgBankInfo(info);
 }
 
 void Cartridge::SetNameTable(std::array<uint8_t,2048> *nt)
@@ -188,6 +207,16 @@ void Cartridge::Run(int cpu_cycles)
         mapper_->CpuClock();
 }
 
+int Cartridge::GetCyclesToIRQ() const
+{
+    return mapper_->GetCyclesToIRQ();
+}
+
+bool Cartridge::IsScanlineIRQEnabled() const
+{
+    return mapper_->IsScanlineIRQEnabled();
+}
+
 bool Cartridge::IsMapperSupported() const
 {
     return mapper_ != nullptr;
@@ -219,7 +248,7 @@ int Cartridge::save_battery_ram() const
     if (!ofs)
         return -1;
 
-    const std::vector<uint8_t> sram = mapper_->GetPrgRam();
+    const std::vector<uint8_t> &sram = mapper_->GetPrgRam();
     if (sram.size() != 0x2000)
         return -1;
 
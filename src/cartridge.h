@@ -22,8 +22,8 @@ struct CartridgeStatus {
 
     int prg_bank_count = 0;
     int chr_bank_count = 0;
-    std::vector<int> prg_selected;
-    std::vector<int> chr_selected;
+    BankInfo prg_banks;
+    BankInfo chr_banks;
 };
 
 class Cartridge {
@@ -32,6 +32,8 @@ public:
     ~Cartridge();
 
     bool Open(const char *filename);
+    // reads an iNES image from memory or any stream. no battery file
+    bool Open(std::istream &is);
 
     uint8_t ReadPrg(uint16_t addr) const;
     uint8_t ReadChr(uint16_t addr) const;
@@ -41,17 +43,23 @@ public:
     void WriteNameTable(uint16_t addr, uint8_t data);
 
     uint8_t PeekPrg(uint32_t physical_addr) const;
+    // host memory of PRG ROM at CPU $8000-$FFFF or nullptr. Mapper::GetPrgRomData()
+    const uint8_t *GetPrgRomData(uint16_t addr) const;
 
     int GetMapperID() const;
     size_t GetPrgSize() const;
     size_t GetChrSize() const;
     void GetCartridgeStatus(CartridgeStatus &stat) const;
+    void GetPrgBankInfo(BankInfo &info) const;
     void SetNameTable(std::array<uint8_t,2048> *nt);
 
     bool IsSetIRQ() const;
     void ClearIRQ();
     void PpuClock(int cycle, int scanline);
     void Run(int cpu_cycles);
+    // Mapper::GetCyclesToIRQ() and Mapper::IsScanlineIRQEnabled()
+    int GetCyclesToIRQ() const;
+    bool IsScanlineIRQEnabled() const;
 
     bool IsMapperSupported() const;
     bool IsVerticalMirroring() const;
@@ -80,6 +88,11 @@ private:
         SERIALIZE_NAMESPACE_END(ar);
     }
 
+    friend void HashState(StateHash &h, const Cartridge *data)
+    {
+        HashState(h, data->mapper_.get());
+    }
+
     int save_battery_ram() const;
     int load_battery_ram();
 };
@@ -1,185 +1,198 @@
+#include <algorithm>
 #include <cstring>
 #include "cpu.h"
+#include "instruction_table.h"
 #include "ppu.h"
 #include "apu.h"
 #include "cartridge.h"
 #include "debug.h"
+#include "heatmap.h"
+#include "jit.h"
+#include "latency.h"
+#include "hooks.h"
 
 namespace nes {
 
-enum StatusFlag {
-    C = 1 << 0, // carry
-    Z = 1 << 1, // zero
-    I = 1 << 2, // disable interrupts
-    D = 1 << 3, // decimal mode
-    B = 1 << 4, // break
-    U = 1 << 5, // unused
-    V = 1 << 6, // overflow
-    N = 1 << 7  // negative
-};
-
-CPU::CPU(PPU &ppu, APU &apu) : ppu_(ppu), apu_(apu)
+CPU::CPU(PPU &ppu, APU &apu) : ppu_(ppu), apu_(apu), blocks_(BLOCK_COUNT)
 {
+    init_pages();
 }
 
 CPU::~CPU()
 {
 }
 
-void CPU::write_byte(uint16_t addr, uint8_t data)
+void CPU::init_pages()
 {
-    if (addr >= 0x0000 && addr <= 0x1FFF) {
-        wram_[addr & 0x07FF] = data;
-    }
-    else if (addr == 0x2000) {
-        ppu_.WriteControl(data);
-    }
-    else if (addr == 0x2001) {
-        ppu_.WriteMask(data);
-    }
-    else if (addr == 0x2002) {
-        // PPU status not writable
-    }
-    else if (addr == 0x2003) {
-        ppu_.WriteOamAddress(data);
-    }
-    else if (addr == 0x2004) {
-        ppu_.WriteOamData(data);
-    }
-    else if (addr == 0x2005) {
-        ppu_.WriteScroll(data);
-    }
-    else if (addr == 0x2006) {
-        ppu_.WriteAddress(data);
-    }
-    else if (addr == 0x2007) {
-        ppu_.WriteData(data);
-    }
-    else if (addr >= 0x2008 && addr <= 0x3FFF) {
-        // PPU register mirrored every 8
-        write_byte(0x2000 | (addr & 0x007), data);
-    }
-    else if (addr == 0x4000) {
-        apu_.WriteSquare1Volume(data);
-    }
-    else if (addr == 0x4001) {
-        apu_.WriteSquare1Sweep(data);
-    }
-    else if (addr == 0x4002) {
-        apu_.WriteSquare1Lo(data);
-    }
-    else if (addr == 0x4003) {
-        apu_.WriteSquare1Hi(data);
-    }
-    else if (addr == 0x4004) {
-        apu_.WriteSquare2Volume(data);
-    }
-    else if (addr == 0x4005) {
-        apu_.WriteSquare2Sweep(data);
-    }
-    else if (addr == 0x4006) {
-        apu_.WriteSquare2Lo(data);
-    }
-    else if (addr == 0x4007) {
-        apu_.WriteSquare2Hi(data);
-    }
-    else if (addr == 0x4008) {
-        apu_.WriteTriangleLinear(data);
-    }
-    else if (addr == 0x400A) {
-        apu_.WriteTriangleLo(data);
-    }
-    else if (addr == 0x400B) {
-        apu_.WriteTriangleHi(data);
-    }
-    else if (addr == 0x400C) {
-        apu_.WriteNoiseVolume(data);
-    }
-    else if (addr == 0x400E) {
-        apu_.WriteNoiseLo(data);
-    }
-    else if (addr == 0x400F) {
-        apu_.WriteNoiseHi(data);
-    }
-    else if (addr == 0x4010) {
-        apu_.WriteDmcFrequency(data);
+    for (int page = 0x00; page <= 0xFF; page++) {
+        BusPage &p = pages_[page];
+
+        if (page <= 0x1F) {
+            // 4 2KB rams. 3 of them are mirroring
+            p.write_mem = &wram_[(page & 0x07) << 8];
+            p.read_mem = p.write_mem;
+        }
+        else if (page <= 0x3F) {
+            // PPU registers mirrored every 8
+            p.read = &CPU::read_ppu;
+            p.write = &CPU::write_ppu;
+        }
+        else if (page == 0x40) {
+            p.read = &CPU::read_io;
+            p.write = &CPU::write_io;
+        }
+        else {
+            p.read = &CPU::read_cart;
+            p.write = &CPU::write_cart;
+        }
     }
-    else if (addr == 0x4011) {
-        apu_.WriteDmcLoadCounter(data);
+}
+
+void CPU::update_prg_pages()
+{
+    // PRG ROM windows are 8KB or larger. a page per window is enough to
+    // see if the window moved
+    const int PAGES_PER_WINDOW = 0x2000 >> 8;
+
+    for (int page = 0x80; page <= 0xFF; page += PAGES_PER_WINDOW) {
+        const uint8_t *mem = cart_ ? cart_->GetPrgRomData(page << 8) : nullptr;
+        if (mem == pages_[page].read_mem)
+            continue;
+
+        for (int i = 0; i < PAGES_PER_WINDOW; i++)
+            pages_[page + i].read_mem = mem ? mem + (i << 8) : nullptr;
     }
-    else if (addr == 0x4012) {
-        apu_.WriteDmcSampleAddress(data);
+}
+
+void CPU::write_byte(uint16_t addr, uint8_t data)
+{
+    if (DebugHooks::stats)
+        write_count_++;
+    if (DebugHooks::access && access_)
+        access_->Count(ACCESS_WRITE, addr);
+
+    const BusPage &page = pages_[addr >> 8];
+    if (page.write_mem)
+        page.write_mem[addr & 0xFF] = data;
+    else
+        (this->*page.write)(addr, data);
+}
+
+uint8_t CPU::read_byte(uint16_t addr)
+{
+    if (DebugHooks::access && access_)
+        access_->Count(ACCESS_READ, addr);
+
+    const BusPage &page = pages_[addr >> 8];
+    if (page.read_mem)
+        return page.read_mem[addr & 0xFF];
+    else
+        return (this->*page.read)(addr);
+}
+
+void CPU::write_ppu(uint16_t addr, uint8_t data)
+{
+    switch (addr & 0x007) {
+    case 0: ppu_.WriteControl(data); break;
+    case 1: ppu_.WriteMask(data); break;
+    case 2: break; // PPU status not writable
+    case 3: ppu_.WriteOamAddress(data); break;
+    case 4: ppu_.WriteOamData(data); break;
+    case 5: ppu_.WriteScroll(data); break;
+    case 6: ppu_.WriteAddress(data); break;
+    case 7: ppu_.WriteData(data); break;
     }
-    else if (addr == 0x4013) {
-        apu_.WriteDmcSampleLength(data);
+}
+
+uint8_t CPU::read_ppu(uint16_t addr)
+{
+    // control, mask, oam address, scroll and address not readable
+    switch (addr & 0x007) {
+    case 2: return ppu_.ReadStatus();
+    case 4: return ppu_.ReadOamData();
+    case 7: return ppu_.ReadData();
+    default: return 0;
     }
-    else if (addr == 0x4014) {
+}
+
+void CPU::write_io(uint16_t addr, uint8_t data)
+{
+    switch (addr) {
+    case 0x4000: apu_.WriteSquare1Volume(data); break;
+    case 0x4001: apu_.WriteSquare1Sweep(data); break;
+    case 0x4002: apu_.WriteSquare1Lo(data); break;
+    case 0x4003: apu_.WriteSquare1Hi(data); break;
+    case 0x4004: apu_.WriteSquare2Volume(data); break;
+    case 0x4005: apu_.WriteSquare2Sweep(data); break;
+    case 0x4006: apu_.WriteSquare2Lo(data); break;
+    case 0x4007: apu_.WriteSquare2Hi(data); break;
+    case 0x4008: apu_.WriteTriangleLinear(data); break;
+    case 0x400A: apu_.WriteTriangleLo(data); break;
+    case 0x400B: apu_.WriteTriangleHi(data); break;
+    case 0x400C: apu_.WriteNoiseVolume(data); break;
+    case 0x400E: apu_.WriteNoiseLo(data); break;
+    case 0x400F: apu_.WriteNoiseHi(data); break;
+    case 0x4010: apu_.WriteDmcFrequency(data); break;
+    case 0x4011: apu_.WriteDmcLoadCounter(data); break;
+    case 0x4012: apu_.WriteDmcSampleAddress(data); break;
+    case 0x4013: apu_.WriteDmcSampleLength(data); break;
+
+    case 0x4014:
         // DMA
         ppu_.WriteOamDma(data);
         suspended_ = true;
-    }
-    else if (addr == 0x4015) {
+        break;
+
+    case 0x4015:
         apu_.WriteStatus(data);
-    }
-    else if (addr == 0x4016) {
-        const int id = addr & 0x001;
-        controller_state_[id] = controller_input_[id];
-    }
-    else if (addr == 0x4017) {
+        break;
+
+    case 0x4016:
+        controller_state_[0] = controller_input_[0];
+        if (DebugHooks::latency && latency_)
+            latency_->Latch(controller_state_[0]);
+        break;
+
+    case 0x4017:
         apu_.WriteFrameCounter(data);
-    }
-    else {
-        cart_->WritePrg(addr, data);
+        break;
+
+    default:
+        write_cart(addr, data);
+        break;
     }
 }
 
-uint8_t CPU::read_byte(uint16_t addr)
+uint8_t CPU::read_io(uint16_t addr)
 {
-    if (addr >= 0x0000 && addr <= 0x1FFF) {
-        return wram_[addr & 0x07FF];
-    }
-    else if (addr == 0x2000) {
-        // PPU control not readable
-    }
-    else if (addr == 0x2001) {
-        // PPU mask not readable
-    }
-    else if (addr == 0x2002) {
-        return ppu_.ReadStatus();
-    }
-    else if (addr == 0x2003) {
-        // PPU oam address not readable
-    }
-    else if (addr == 0x2004) {
-        return ppu_.ReadOamData();
-    }
-    else if (addr == 0x2005) {
-        // PPU scroll not readable
-    }
-    else if (addr == 0x2006) {
-        // PPU address not readable
-    }
-    else if (addr == 0x2007) {
-        return ppu_.ReadData();
-    }
-    else if (addr >= 0x2008 && addr <= 0x3FFF) {
-        // PPU register mirrored every 8
-        return read_byte(0x2000 | (addr & 0x007));
-    }
-    else if (addr == 0x4015) {
+    if (addr == 0x4015) {
         return apu_.ReadStatus();
     }
     else if (addr >= 0x4016 && addr <= 0x4017) {
         const int id = addr & 0x001;
         const uint8_t data = (controller_state_[id] & 0x80) > 0;
+        if (DebugHooks::stats)
+            frame_stats_.controller_read = true;
+        if (DebugHooks::latency && latency_ && id == 0)
+            latency_->Read();
         controller_state_[id] <<= 1;
         return data;
     }
     else {
         return cart_->ReadPrg(addr);
     }
+}
+
+void CPU::write_cart(uint16_t addr, uint8_t data)
+{
+    // may switch banks
+    cart_->WritePrg(addr, data);
+    update_prg_pages();
+}
 
-    return 0;
+uint8_t CPU::read_cart(uint16_t addr)
+{
+    return cart_->ReadPrg(addr);
 }
 
 uint8_t CPU::peek_byte(uint16_t addr) const
@@ -198,7 +211,14 @@ uint8_t CPU::peek_byte(uint16_t addr) const
         return (controller_state_[id] & 0x80) > 0;
     }
 
-    return const_cast<CPU*>(this)->read_byte(addr);
+    // peeks are not bus accesses
+    CPU *self = const_cast<CPU*>(this);
+    AccessCounter *counter = self->access_;
+    self->access_ = nullptr;
+    const uint8_t data = self->read_byte(addr);
+    self->access_ = counter;
+
+    return data;
 }
 
 uint16_t CPU::peek_word(uint16_t addr) const
@@ -230,6 +250,25 @@ uint16_t CPU::fetch_word()
     return (hi << 8) | lo;
 }
 
+bool CPU::is_direct_read(uint16_t addr) const
+{
+    return pages_[addr >> 8].read_mem;
+}
+
+uint8_t CPU::peek_direct(uint16_t addr) const
+{
+    // only for pages with memory
+    return pages_[addr >> 8].read_mem[addr & 0xFF];
+}
+
+uint16_t CPU::peek_direct_word(uint16_t addr) const
+{
+    const uint16_t lo = peek_direct(addr);
+    const uint16_t hi = peek_direct(addr + 1);
+
+    return (hi << 8) | lo;
+}
+
 static bool is_page_crossing(uint16_t addr, uint8_t addend)
 {
     return (addr & 0x00FF) + (addend & 0x00FF) > 0x00FF;
@@ -259,76 +298,6 @@ uint16_t CPU::zp_indirect(uint8_t zp) const
     return (hi << 8) | lo;
 }
 
-uint16_t CPU::fetch_address(int mode, bool *page_crossed)
-{
-    *page_crossed = 0;
-
-    switch (mode) {
-
-    case ABS:
-        return fetch_word();
-
-    case ABX:
-        return abs_index(fetch_word(), x_, page_crossed);
-
-    case ABY:
-        return abs_index(fetch_word(), y_, page_crossed);
-
-    case ACC:
-        // no address for register
-        return 0;
-
-    case IMM:
-        // address where the immediate value is stored
-        return pc_++;
-
-    case IMP:
-        // no address
-        return 0;
-
-    case IND:
-        return abs_indirect(fetch_word());
-
-    case IZX:
-        // addr = {[arg + X], [arg + X + 1]}
-        return zp_indirect(fetch() + x_);
-
-    case IZY:
-        {
-            // addr = {[arg], [arg + 1]} + Y
-            const uint16_t addr = zp_indirect(fetch());
-            if (is_page_crossing(addr, y_))
-                *page_crossed = 1;
-            return addr + y_;
-        }
-
-    case REL:
-        {
-            // fetch data first, then add it to the PC
-            const uint8_t offset = fetch();
-            const uint16_t old_pc = pc_;
-            const uint16_t new_pc = pc_ + static_cast<int8_t>(offset);
-
-            if ((old_pc & 0xFF00) != (new_pc & 0xFF00))
-                *page_crossed = 1;
-
-            return new_pc;
-        }
-
-    case ZPG:
-        return fetch();
-
-    case ZPX:
-        return (fetch() + x_) & 0x00FF;
-
-    case ZPY:
-        return (fetch() + y_) & 0x00FF;
-
-    default:
-        return 0;
-    }
-}
-
 void CPU::set_pc(uint16_t addr)
 {
     pc_ = addr;
@@ -336,21 +305,43 @@ void CPU::set_pc(uint16_t addr)
 
 void CPU::set_flag(uint8_t flag, uint8_t val)
 {
-    if (val)
-        p_ |= flag;
-    else
-        p_ &= ~flag;
+    // flag is a constant where inlined. only its case is left
+    switch (flag) {
+    case C:
+        carry_ = val != 0;
+        break;
+
+    case Z:
+        z_result_ = val == 0;
+        break;
+
+    case N:
+        n_result_ = val ? 0x80 : 0x00;
+        break;
+
+    default:
+        if (val)
+            p_ |= flag;
+        else
+            p_ &= ~flag;
+        break;
+    }
 }
 
 uint8_t CPU::get_flag(uint8_t flag) const
 {
-    return (p_ & flag) > 0;
+    switch (flag) {
+    case C: return carry_;
+    case Z: return z_result_ == 0;
+    case N: return n_result_ >> 7;
+    default: return (p_ & flag) > 0;
+    }
 }
 
 uint8_t CPU::update_zn(uint8_t val)
 {
-    set_flag(Z, val == 0x00);
-    set_flag(N, val & 0x80);
+    z_result_ = val;
+    n_result_ = val;
     return val;
 }
 
@@ -380,6 +371,15 @@ void CPU::set_s(uint8_t val)
 void CPU::set_p(uint8_t val)
 {
     p_ = val | U;
+    z_result_ = ~val & Z;
+    n_result_ = val & N;
+    carry_ = val & C;
+}
+
+uint8_t CPU::get_p() const
+{
+    return (p_ & ~(N | Z | C)) |
+           (n_result_ & N) | (z_result_ == 0 ? Z : 0) | carry_;
 }
 
 void CPU::push(uint8_t val)
@@ -419,10 +419,29 @@ bool CPU::branch_if(uint16_t addr, bool cond)
     if (!cond)
         return false;
 
+    if (DebugHooks::stats)
+        count_spin(addr);
     set_pc(addr);
     return true;
 }
 
+void CPU::count_spin(uint16_t target)
+{
+    // a short backward jump taken again with no writes in between is
+    // a busy wait like "LDA $xx; BEQ -4" or "BIT $2002; BPL -5"
+    const int SPIN_LOOP_BYTES = 8;
+
+    if (target > pc_ || pc_ - target > SPIN_LOOP_BYTES)
+        return;
+
+    if (target == spin_target_ && write_count_ == spin_write_count_)
+        frame_stats_.spin_cycles += total_cycles_ - spin_cycle_;
+
+    spin_target_ = target;
+    spin_cycle_ = total_cycles_;
+    spin_write_count_ = write_count_;
+}
+
 static bool is_positive(uint8_t val)
 {
     return !(val & 0x80);
@@ -442,19 +461,149 @@ void CPU::add_a_m(uint8_t data)
     set_a(r);
 }
 
-static Instruction decode(uint8_t opcode)
+template<int Mode>
+uint16_t CPU::fetch_operand()
 {
-    return Decode(opcode);
+    switch (get_instruction_bytes(Mode)) {
+    case 3:
+        return fetch_word();
+
+    case 2:
+        if (Mode == IMM) {
+            // read by the operation from its address
+            pc_++;
+            return 0;
+        }
+        return fetch();
+
+    default:
+        return 0;
+    }
 }
 
-int CPU::execute(Instruction inst)
+template<int Mode>
+uint16_t CPU::get_address(uint16_t operand, bool &page_crossed) const
 {
-    bool page_crossed = false;
-    bool branch_taken = false;
-    const uint8_t mode = inst.addr_mode;
-    const uint16_t addr = fetch_address(mode, &page_crossed);
+    // Mode is a constant. only its case is left. PC is at the next
+    // instruction
+    switch (Mode) {
+
+    case ABS:
+        return operand;
+
+    case ABX:
+        return abs_index(operand, x_, &page_crossed);
+
+    case ABY:
+        return abs_index(operand, y_, &page_crossed);
+
+    case ACC:
+        // no address for register
+        return 0;
+
+    case IMM:
+        // address where the immediate value is stored
+        return pc_ - 1;
+
+    case IMP:
+        // no address
+        return 0;
+
+    case IND:
+        return abs_indirect(operand);
+
+    case IZX:
+        // addr = {[arg + X], [arg + X + 1]}
+        return zp_indirect(operand + x_);
+
+    case IZY:
+        {
+            // addr = {[arg], [arg + 1]} + Y
+            const uint16_t addr = zp_indirect(operand);
+            if (is_page_crossing(addr, y_))
+                page_crossed = true;
+            return addr + y_;
+        }
 
-    switch (inst.operation) {
+    case REL:
+        {
+            // add the offset to the PC
+            const uint16_t old_pc = pc_;
+            const uint16_t new_pc = pc_ + static_cast<int8_t>(operand);
+
+            if ((old_pc & 0xFF00) != (new_pc & 0xFF00))
+                page_crossed = true;
+
+            return new_pc;
+        }
+
+    case ZPG:
+        return operand & 0x00FF;
+
+    case ZPX:
+        return (operand + x_) & 0x00FF;
+
+    case ZPY:
+        return (operand + y_) & 0x00FF;
+
+    default:
+        return 0;
+    }
+}
+
+template<int Mode>
+uint16_t CPU::peek_address() const
+{
+    // get_address() without fetching. code and zero page are memory.
+    // the address of the pointer for IND
+    const uint16_t operand = pc_ + 1;
+
+    switch (Mode) {
+
+    case ABS: case IND:
+        return peek_direct_word(operand);
+
+    case ABX:
+        return peek_direct_word(operand) + x_;
+
+    case ABY:
+        return peek_direct_word(operand) + y_;
+
+    case IZX:
+        {
+            const uint8_t zp = peek_direct(operand) + x_;
+            const uint16_t lo = peek_direct(zp);
+            const uint16_t hi = peek_direct((zp + 1) & 0xFF);
+            return (hi << 8) | lo;
+        }
+
+    case IZY:
+        {
+            const uint8_t zp = peek_direct(operand);
+            const uint16_t lo = peek_direct(zp);
+            const uint16_t hi = peek_direct((zp + 1) & 0xFF);
+            return ((hi << 8) | lo) + y_;
+        }
+
+    case ZPG:
+        return peek_direct(operand);
+
+    case ZPX:
+        return (peek_direct(operand) + x_) & 0x00FF;
+
+    case ZPY:
+        return (peek_direct(operand) + y_) & 0x00FF;
+
+    default:
+        return 0;
+    }
+}
+
+template<int Oper, int Mode>
+void CPU::operate(uint16_t addr)
+{
+    // Oper is a constant. only its case is left
+    switch (Oper) {
 
     // Load Accumulator with Memory: M -> A (N, Z)
     case LDA:
@@ -523,7 +672,7 @@ int CPU::execute(Instruction inst)
 
     // Push Processor Status on Stack: ()
     case PHP:
-        push(p_ | B);
+        push(get_p() | B);
         break;
 
     // Pull Accumulator from Stack: (N, Z)
@@ -538,7 +687,7 @@ int CPU::execute(Instruction inst)
 
     // Arithmetic Shift Left: C <- /M7...M0/ <- 0 (N, Z, C)
     case ASL:
-        if (mode == ACC) {
+        if (Mode == ACC) {
             const uint8_t data = a_;
             set_flag(C, data & 0x80);
             set_a(data << 1);
@@ -553,7 +702,7 @@ int CPU::execute(Instruction inst)
 
     // Logical Shift Right: 0 -> /M7...M0/ -> C (N, Z, C)
     case LSR:
-        if (mode == ACC) {
+        if (Mode == ACC) {
             const uint8_t data = a_;
             set_flag(C, data & 0x01);
             set_a(data >> 1);
@@ -568,7 +717,7 @@ int CPU::execute(Instruction inst)
 
     // Rotate Left: C <- /M7...M0/ <- C (N, Z, C)
     case ROL:
-        if (mode == ACC) {
+        if (Mode == ACC) {
             const uint8_t carry = get_flag(C);
             const uint8_t data = a_;
             set_flag(C, data & 0x80);
@@ -585,7 +734,7 @@ int CPU::execute(Instruction inst)
 
     // Rotate Right: C -> /M7...M0/ -> C (N, Z, C)
     case ROR:
-        if (mode == ACC) {
+        if (Mode == ACC) {
             const uint8_t carry = get_flag(C);
             const uint8_t data = a_;
             set_flag(C, data & 0x01);
@@ -619,8 +768,8 @@ int CPU::execute(Instruction inst)
     case BIT:
         {
             const uint8_t data = read_byte(addr);
-            set_flag(Z, (a_ & data) == 0x00);
-            set_flag(N, data & N);
+            z_result_ = a_ & data;
+            n_result_ = data;
             set_flag(V, data & V);
         }
         break;
@@ -694,6 +843,8 @@ int CPU::execute(Instruction inst)
 
     // Jump Indirect: [PC + 1] -> PCL, [PC + 2] -> PCH ()
     case JMP:
+        if (DebugHooks::stats)
+            count_spin(addr);
         set_pc(addr);
         break;
 
@@ -709,7 +860,7 @@ int CPU::execute(Instruction inst)
         // an extra byte of spacing for a break mark
         // 5  $0100,S  W  push P on stack (with B flag set), decrement S
         push_word(pc_ + 1);
-        push(p_ | B);
+        push(get_p() | B);
 
         set_flag(I, 1);
         set_pc(read_word(0xFFFE));
@@ -719,6 +870,13 @@ int CPU::execute(Instruction inst)
     case RTI:
         set_p(pop());
         set_pc(pop_word());
+
+        if (DebugHooks::stats && in_nmi_) {
+            // RTI takes 6 cycles
+            frame_stats_.nmi_handler_cycles = total_cycles_ + 6 - nmi_cycle_;
+            frame_stats_.nmi_returned = true;
+            in_nmi_ = false;
+        }
         break;
 
     // Return from Subroutine: pop(PC), PC + 1 -> PC ()
@@ -727,46 +885,6 @@ int CPU::execute(Instruction inst)
         set_pc(pc_ + 1);
         break;
 
-    // Branch on Carry Clear: ()
-    case BCC:
-        branch_taken = branch_if(addr, get_flag(C) == 0);
-        break;
-
-    // Branch on Carry Set: ()
-    case BCS:
-        branch_taken = branch_if(addr, get_flag(C) == 1);
-        break;
-
-    // Branch on Result Zero: ()
-    case BEQ:
-        branch_taken = branch_if(addr, get_flag(Z) == 1);
-        break;
-
-    // Branch on Result Minus: ()
-    case BMI:
-        branch_taken = branch_if(addr, get_flag(N) == 1);
-        break;
-
-    // Branch on Result Not Zero: ()
-    case BNE:
-        branch_taken = branch_if(addr, get_flag(Z) == 0);
-        break;
-
-    // Branch on Result Plus: ()
-    case BPL:
-        branch_taken = branch_if(addr, get_flag(N) == 0);
-        break;
-
-    // Branch on Overflow Clear: ()
-    case BVC:
-        branch_taken = branch_if(addr, get_flag(V) == 0);
-        break;
-
-    // Branch on Overflow Set: ()
-    case BVS:
-        branch_taken = branch_if(addr, get_flag(V) == 1);
-        break;
-
     // Clear Carry Flag: 0 -> C (C)
     case CLC:
         set_flag(C, 0);
@@ -896,26 +1014,332 @@ int CPU::execute(Instruction inst)
     default:
         break;
     }
+}
 
-    // Adjust page crossed
-    switch (inst.operation) {
-    case ASL: case DEC: case INC: case LSR: case ROL: case ROR: case STA:
-    case DCP: case ISC: case RLA: case RRA: case SLO: case SRE:
-        page_crossed = 0;
-        break;
+template<int Oper>
+bool CPU::branch_condition() const
+{
+    switch (Oper) {
+    // Branch on Carry Clear: ()
+    case BCC: return get_flag(C) == 0;
+    // Branch on Carry Set: ()
+    case BCS: return get_flag(C) == 1;
+    // Branch on Result Zero: ()
+    case BEQ: return get_flag(Z) == 1;
+    // Branch on Result Minus: ()
+    case BMI: return get_flag(N) == 1;
+    // Branch on Result Not Zero: ()
+    case BNE: return get_flag(Z) == 0;
+    // Branch on Result Plus: ()
+    case BPL: return get_flag(N) == 0;
+    // Branch on Overflow Clear: ()
+    case BVC: return get_flag(V) == 0;
+    // Branch on Overflow Set: ()
+    case BVS: return get_flag(V) == 1;
+    default: return false;
+    }
+}
 
-    case BCC: case BCS: case BEQ: case BMI:
-    case BNE: case BPL: case BVC: case BVS:
-        page_crossed = branch_taken ? page_crossed : 0;
-        break;
+// stores and read-modify-writes take the same cycles on a page crossing
+static constexpr bool takes_page_cross_cycle(int oper)
+{
+    return !(oper == ASL || oper == DEC || oper == INC || oper == LSR ||
+             oper == ROL || oper == ROR || oper == STA ||
+             oper == DCP || oper == ISC || oper == RLA || oper == RRA ||
+             oper == SLO || oper == SRE);
+}
+
+template<int Code>
+int CPU::execute()
+{
+    constexpr int mode = addr_mode_table[Code];
+
+    const uint16_t operand = fetch_operand<mode>();
+    return execute_operand<Code>(operand);
+}
+
+template<int Code>
+int CPU::execute_operand(uint16_t operand)
+{
+    constexpr int oper = operation_table[Code];
+    constexpr int mode = addr_mode_table[Code];
+    constexpr int cycles = cycle_table[Code];
+
+    bool page_crossed = false;
+    const uint16_t addr = get_address<mode>(operand, page_crossed);
+
+    if (is_branch(oper)) {
+        // a cycle if taken and another if taken to the next page
+        if (!branch_if(addr, branch_condition<oper>()))
+            return cycles;
+        return cycles + 1 + page_crossed;
+    }
+
+    operate<oper, mode>(addr);
+
+    if (takes_page_cross_cycle(oper))
+        return cycles + page_crossed;
+    else
+        return cycles;
+}
+
+enum OperandAccess {
+    OPERAND_NONE = 0,
+    OPERAND_READ,
+    OPERAND_WRITE,
+    OPERAND_MODIFY
+};
+
+static constexpr int operand_access(int oper, int mode)
+{
+    if (mode == IMP || mode == ACC || mode == IMM || mode == REL)
+        return OPERAND_NONE;
+
+    switch (oper) {
+    case JMP: case JSR: case NOP: case ILL:
+        return OPERAND_NONE;
+
+    case STA: case STX: case STY: case SAX:
+        return OPERAND_WRITE;
+
+    case ASL: case LSR: case ROL: case ROR: case INC: case DEC:
+    case DCP: case ISC: case SLO: case RLA: case SRE: case RRA:
+        return OPERAND_MODIFY;
+
+    default:
+        return OPERAND_READ;
     }
+}
+
+template<int Code>
+bool CPU::accesses_io() const
+{
+    constexpr int oper = operation_table[Code];
+    constexpr int mode = addr_mode_table[Code];
+    constexpr int bytes = get_instruction_bytes(mode);
+    constexpr int access = operand_access(oper, mode);
 
-    return inst.cycles + page_crossed + branch_taken;
+    // the opcode is checked by the caller. stack is RAM
+    if (bytes > 1 && !is_direct_read(pc_ + bytes - 1))
+        return true;
+
+    if (oper == BRK)
+        return !is_direct_read(0xFFFE);
+
+    if (mode == IND)
+        // the pointer is in a page
+        return !is_direct_read(peek_address<mode>());
+
+    if (access == OPERAND_NONE)
+        return false;
+
+    const BusPage &page = pages_[peek_address<mode>() >> 8];
+
+    switch (access) {
+    case OPERAND_READ:  return !page.read_mem;
+    case OPERAND_WRITE: return !page.write_mem;
+    default:            return !page.read_mem || !page.write_mem;
+    }
+}
+
+template<int Code>
+bool CPU::check_io(const CPU &cpu)
+{
+    return cpu.accesses_io<Code>();
+}
+
+template<int... Codes>
+constexpr CPU::IoCheckTable CPU::make_io_checks(std::integer_sequence<int,Codes...>)
+{
+    return {{ &CPU::check_io<Codes>... }};
+}
+
+template<int Code>
+int CPU::dispatch(CPU &cpu)
+{
+    return cpu.execute<Code>();
+}
+
+template<int... Codes>
+constexpr CPU::HandlerTable CPU::make_handlers(std::integer_sequence<int,Codes...>)
+{
+    return {{ &CPU::dispatch<Codes>... }};
+}
+
+template<int Code>
+int CPU::dispatch_decoded(CPU &cpu, uint16_t operand)
+{
+    // fetched already
+    cpu.pc_ += get_instruction_bytes(addr_mode_table[Code]);
+    return cpu.execute_operand<Code>(operand);
+}
+
+template<int... Codes>
+constexpr CPU::DecodedHandlerTable CPU::make_decoded_handlers(std::integer_sequence<int,Codes...>)
+{
+    return {{ &CPU::dispatch_decoded<Codes>... }};
+}
+
+CPU::DecodedHandler CPU::get_decoded_handler(uint8_t code)
+{
+    static constexpr DecodedHandlerTable handlers =
+        make_decoded_handlers(std::make_integer_sequence<int,256>());
+
+    return handlers[code];
+}
+
+// false if the instruction accesses only RAM wherever the bus pages point.
+// zero page, stack and $0000-$1FFF are RAM
+static constexpr bool may_access_io(int oper, int mode, uint16_t operand)
+{
+    if (oper == BRK || mode == IND)
+        return true;
+
+    if (operand_access(oper, mode) == OPERAND_NONE)
+        return false;
+
+    switch (mode) {
+    case ZPG: case ZPX: case ZPY:
+        return false;
+
+    case ABS:
+        return operand >= 0x2000;
+
+    default:
+        return true;
+    }
+}
+
+const CPU::CodeBlock *CPU::find_block()
+{
+    if (engine_ == CPU_ENGINE_INTERPRETER)
+        return nullptr;
+
+    // fetches are counted one by one
+    if (DebugHooks::access && access_)
+        return nullptr;
+
+    // PRG ROM only. it is never written, so blocks are only switched out
+    const BusPage &page = pages_[pc_ >> 8];
+    if (!page.read_mem || page.write_mem)
+        return nullptr;
+
+    const uint8_t *code = &page.read_mem[pc_ & 0xFF];
+    CodeBlock &block = blocks_[pc_ & (BLOCK_COUNT - 1)];
+    if (block.code != code || block.pc != pc_)
+        decode_block(block, pc_, code);
+
+    if (engine_ == CPU_ENGINE_JIT && ++block.run_count == jit_threshold_)
+        compile_block(block);
+
+    return block.count > 0 ? &block : nullptr;
+}
+
+void CPU::decode_block(CodeBlock &block, uint16_t pc, const uint8_t *code)
+{
+    block.code = code;
+    block.pc = pc;
+    block.count = 0;
+    block.native = nullptr;
+    block.native_cycles = 0;
+    block.run_count = 0;
+
+    // the tag is checked for this page only
+    const int page_end = 0x100 - (pc & 0xFF);
+    int offset = 0;
+
+    // code[] ends at the page. $FFFF is the last byte of PRG ROM
+    while (block.count < CodeBlock::MAX_OPS && offset < page_end) {
+        const uint8_t opcode = code[offset];
+        const int oper = operation_table[opcode];
+        const int mode = addr_mode_table[opcode];
+        const int bytes = get_instruction_bytes(mode);
+
+        if (offset + bytes > page_end)
+            break;
+
+        uint16_t operand = 0;
+        if (bytes == 3)
+            operand = code[offset + 1] | (code[offset + 2] << 8);
+        else if (bytes == 2)
+            operand = code[offset + 1];
+
+        DecodedOp &op = block.ops[block.count++];
+        op.handler = get_decoded_handler(opcode);
+        op.operand = operand;
+        op.code = opcode;
+        op.bytes = bytes;
+        op.check_io = may_access_io(oper, mode, operand);
+
+        offset += bytes;
+        if (ends_block(oper))
+            break;
+    }
+}
+
+void CPU::clear_blocks()
+{
+    std::fill(blocks_.begin(), blocks_.end(), CodeBlock());
+    if (jit_buffer_)
+        jit_buffer_->Clear();
+}
+
+bool CPU::run_block(const CodeBlock &block, uint64_t target_cycle, int &cycles)
+{
+    // returns true when the batch ends. false to find the next block
+    int i = 0;
+
+    // the native code checks neither the target nor interrupts. runs when
+    // the batch ends after it and no interrupt waits for an instruction
+    if (block.native && total_cycles_ + block.native_cycles < target_cycle &&
+        !interrupt_pending()) {
+        const uint64_t start_cycles = total_cycles_;
+        i = block.native(this);
+        cycles += static_cast<int>(total_cycles_ - start_cycles);
+
+        if (i == block.count)
+            return false;
+    }
+
+    for (; i < block.count; i++) {
+        const DecodedOp &op = block.ops[i];
+
+        const bool io = op.check_io && get_io_check(op.code)(*this);
+        if (io && cycles > 0)
+            return true;
+
+        const uint16_t next_pc = pc_ + op.bytes;
+        cycles += run_decoded(op);
+
+        if (io || suspended_ || total_cycles_ >= target_cycle)
+            return true;
+
+        // branched or interrupted
+        if (pc_ != next_pc)
+            return false;
+    }
+
+    return false;
+}
+
+int CPU::run_decoded(const DecodedOp &op)
+{
+    // Run() with the fetch done
+    const int cycles = op.handler(*this, op.operand);
+    total_cycles_ += cycles;
+
+    const int interrupt_cycles = handle_interrupt();
+    total_cycles_ += interrupt_cycles;
+
+    return cycles + interrupt_cycles;
 }
 
 void CPU::SetCartride(Cartridge *cart)
 {
     cart_ = cart;
+    update_prg_pages();
+    // a new ROM may be where the old one was
+    clear_blocks();
 }
 
 void CPU::PowerUp()
@@ -948,23 +1372,95 @@ int CPU::Run()
     int cycles = 0;
 
     cycles = execute_instruction();
-    cycles += handle_interrupt();
-
     total_cycles_ += cycles;
 
+    // interrupt sequence starts at the end of the instruction
+    const int interrupt_cycles = handle_interrupt();
+    total_cycles_ += interrupt_cycles;
+
+    return cycles + interrupt_cycles;
+}
+
+int CPU::RunUntil(uint64_t target_cycle)
+{
+    int cycles = 0;
+
+    for (;;) {
+        const CodeBlock *block = find_block();
+        if (block) {
+            if (run_block(*block, target_cycle, cycles))
+                break;
+            continue;
+        }
+
+        // other components are behind by the cycles run so far
+        const bool io = next_accesses_io();
+        if (io && cycles > 0)
+            break;
+
+        cycles += Run();
+
+        if (io || suspended_ || total_cycles_ >= target_cycle)
+            break;
+    }
+
     return cycles;
 }
 
+void CPU::SetEngine(CpuEngine engine)
+{
+    if (engine == CPU_ENGINE_JIT && !jit_buffer_) {
+        jit_buffer_.reset(new CodeBuffer(JIT_BUFFER_SIZE));
+        jit_emitter_.reset(new X64Emitter);
+    }
+
+    if (engine == CPU_ENGINE_JIT && !(CodeBuffer::IsSupported() && jit_buffer_->IsOpen()))
+        engine_ = CPU_ENGINE_INTERPRETER;
+    else
+        engine_ = engine;
+
+    // blocks counted or compiled by the last engine
+    flush_jit();
+}
+
+CpuEngine CPU::GetEngine() const
+{
+    return engine_;
+}
+
+void CPU::SetJitThreshold(int runs)
+{
+    jit_threshold_ = runs;
+}
+
+CPU::IoCheck CPU::get_io_check(uint8_t code)
+{
+    static constexpr IoCheckTable checks =
+        make_io_checks(std::make_integer_sequence<int,256>());
+
+    return checks[code];
+}
+
+bool CPU::next_accesses_io() const
+{
+    if (!is_direct_read(pc_))
+        return true;
+
+    return get_io_check(peek_direct(pc_))(*this);
+}
+
 int CPU::execute_instruction()
 {
-    uint8_t code, cycs;
-    Instruction inst;
+    // a handler per opcode
+    static constexpr HandlerTable handlers =
+        make_handlers(std::make_integer_sequence<int,256>());
 
-    code = fetch();
-    inst = decode(code);
-    cycs = execute(inst);
+    if (DebugHooks::access && access_)
+        access_->Count(ACCESS_EXECUTE, pc_);
 
-    return cycs;
+    const uint8_t code = fetch();
+
+    return handlers[code](*this);
 }
 
 int CPU::handle_interrupt()
@@ -974,6 +1470,13 @@ int CPU::handle_interrupt()
     if (ppu_.IsSetNMI()) {
         ppu_.ClearNMI();
         cycles = do_interrupt(0xFFFA);
+
+        if (DebugHooks::stats) {
+            nmi_cycle_ = total_cycles_;
+            in_nmi_ = true;
+            frame_stats_.nmi_cycle = nmi_cycle_;
+            frame_stats_.nmi_fired = true;
+        }
     }
     else if (apu_.IsSetIRQ() && !get_flag(I)) {
         cycles = do_interrupt(0xFFFE);
@@ -986,11 +1489,18 @@ int CPU::handle_interrupt()
     return cycles;
 }
 
+bool CPU::interrupt_pending() const
+{
+    // handle_interrupt() after the next instruction would take one
+    return ppu_.IsSetNMI() ||
+           (!get_flag(I) && (apu_.IsSetIRQ() || cart_->IsSetIRQ()));
+}
+
 int CPU::do_interrupt(uint16_t vector)
 {
     // 5  $0100,S  W  push P on stack (with B flag *clear*), decrement S
     push_word(pc_);
-    push(p_ & ~B);
+    push(get_p() & ~B);
     set_flag(I, 1);
     set_pc(read_word(vector));
 
@@ -1025,7 +1535,7 @@ CpuStatus CPU::GetStatus() const
     stat.a  = a_;
     stat.x  = x_;
     stat.y  = y_;
-    stat.p  = p_;
+    stat.p  = get_p();
     stat.s  = s_;
 
     return stat;
@@ -1056,4 +1566,31 @@ uint64_t CPU::GetTotalCycles() const
     return total_cycles_;
 }
 
+void CPU::ClearFrameStats()
+{
+    frame_stats_ = CpuFrameStats();
+    frame_stats_.start_cycle = total_cycles_;
+}
+
+const CpuFrameStats &CPU::GetFrameStats() const
+{
+    return frame_stats_;
+}
+
+void CPU::RestoreState()
+{
+    update_prg_pages();
+    set_p(p_);
+}
+
+void CPU::SetAccessCounter(AccessCounter *counter)
+{
+    access_ = counter;
+}
+
+void CPU::SetLatencyProbe(InputLatency *latency)
+{
+    latency_ = latency;
+}
+
 } // namespace
@@ -3,6 +3,9 @@
 
 #include <cstdint>
 #include <array>
+#include <memory>
+#include <utility>
+#include <vector>
 #include "instruction.h"
 #include "serialize.h"
 
@@ -11,15 +14,46 @@ namespace nes {
 class Cartridge;
 class PPU;
 class APU;
+class AccessCounter;
+class InputLatency;
+class CodeBuffer;
+class X64Emitter;
 
 struct CpuStatus {
     uint16_t pc = 0;
     uint8_t  a = 0, x = 0, y = 0, p = 0, s = 0;
 };
 
+// Per frame counters for lag frame and NMI analysis. Cycles are
+// CPU::GetTotalCycles() values. Not serialized. Only start_cycle is
+// counted without DebugHooks::stats
+struct CpuFrameStats {
+    uint64_t start_cycle = 0;
+    // when the NMI fired in this frame
+    uint64_t nmi_cycle = 0;
+    // cycles of the NMI handler that returned in this frame
+    uint64_t nmi_handler_cycles = 0;
+    uint64_t spin_cycles = 0;
+    bool nmi_fired = false;
+    bool nmi_returned = false;
+    bool controller_read = false;
+};
+
+// how CPU::RunUntil() runs code
+enum CpuEngine {
+    // fetches and decodes every instruction
+    CPU_ENGINE_INTERPRETER = 0,
+    // runs PRG ROM code from cached decoded blocks
+    CPU_ENGINE_BLOCK,
+    // the block engine with hot blocks compiled to x86-64 code
+    CPU_ENGINE_JIT
+};
+
 class CPU {
 public:
     CPU(PPU &ppu, APU &apu);
+    // the bus page table points into wram_
+    CPU(const CPU &) = delete;
     ~CPU();
 
     void SetCartride(Cartridge *cart);
@@ -28,6 +62,17 @@ public:
     void PowerUp();
     void Reset();
     int Run();
+    // runs instructions until the total cycles reach target_cycle, DMA
+    // starts or the next instruction accesses I/O, which needs the other
+    // components run up to it. runs one at least. returns the cycles run
+    int RunUntil(uint64_t target_cycle);
+    // all engines give the same results. the JIT falls back to the
+    // interpreter on hosts other than x86-64. GetEngine() tells
+    void SetEngine(CpuEngine engine);
+    CpuEngine GetEngine() const;
+    // runs of a block before the JIT compiles it. 1 compiles every block
+    // on its first run, for tests
+    void SetJitThreshold(int runs);
 
     // DMA
     void InputController(uint8_t controller_id, uint8_t input);
@@ -35,6 +80,10 @@ public:
     void Resume();
     uint8_t PeekData(uint16_t addr) const;
 
+    // updates what is made from the serialized members after loading a
+    // state: PRG ROM pages of the banks restored and the status flags
+    void RestoreState();
+
     // debug
     CpuStatus GetStatus() const;
     void SetPC(uint16_t addr);
@@ -42,8 +91,25 @@ public:
     uint16_t GetAbsoluteIndirect(uint16_t abs) const;
     uint16_t GetZeroPageIndirect(uint8_t zp) const;
     uint64_t GetTotalCycles() const;
+    void ClearFrameStats();
+    const CpuFrameStats &GetFrameStats() const;
+    // counts bus accesses while set. nullptr to stop
+    void SetAccessCounter(AccessCounter *counter);
+    // reports controller 1 strobes and reads while set. nullptr to stop
+    void SetLatencyProbe(InputLatency *latency);
 
 private:
+    enum StatusFlag {
+        C = 1 << 0, // carry
+        Z = 1 << 1, // zero
+        I = 1 << 2, // disable interrupts
+        D = 1 << 3, // decimal mode
+        B = 1 << 4, // break
+        U = 1 << 5, // unused
+        V = 1 << 6, // overflow
+        N = 1 << 7  // negative
+    };
+
     PPU &ppu_;
     APU &apu_;
     Cartridge *cart_ = nullptr;
@@ -59,15 +125,83 @@ private:
     uint8_t p_ = 0; // processor status
     uint16_t pc_ = 0;
 
+    // N, Z and C are set by most instructions and read by few. kept apart
+    // from p_ and put together by get_p(). Z if z_result_ is 0, N from
+    // bit 7 of n_result_, C if carry_ is 1
+    uint8_t z_result_ = 1;
+    uint8_t n_result_ = 0;
+    uint8_t carry_ = 0;
+
     std::array<uint8_t,2> controller_input_ = {0};
     std::array<uint8_t,2> controller_state_ = {0};
 
     // 4 2KB rams. 3 of them are mirroring
     std::array<uint8_t,2048> wram_ = {0};
 
+    // bus dispatch per 256 byte page. pages with memory are accessed
+    // directly and others go through the handlers. PRG ROM pages are
+    // read only and follow bank switches
+    struct BusPage {
+        const uint8_t *read_mem = nullptr;
+        uint8_t *write_mem = nullptr;
+        uint8_t (CPU::*read)(uint16_t addr) = nullptr;
+        void (CPU::*write)(uint16_t addr, uint8_t data) = nullptr;
+    };
+    std::array<BusPage,256> pages_;
+
+    // decoded PRG ROM code by the address of the first instruction. a block
+    // ends at a jump, a branch or the end of its page. tagged with the host
+    // address of the code, so blocks of banks switched out are missed
+    using DecodedHandler = int (*)(CPU &cpu, uint16_t operand);
+    struct DecodedOp {
+        DecodedHandler handler = nullptr;
+        uint16_t operand = 0;
+        uint8_t code = 0;
+        uint8_t bytes = 0;
+        // false if the instruction never accesses I/O
+        bool check_io = false;
+    };
+    // runs the ops of a block up to one that may access I/O or enable
+    // interrupts. returns how many ran. see cpu_jit.cc
+    using NativeBlock = int (*)(CPU *cpu);
+    struct CodeBlock {
+        static constexpr int MAX_OPS = 16;
+        const uint8_t *code = nullptr;
+        uint16_t pc = 0;
+        int count = 0;
+        std::array<DecodedOp,MAX_OPS> ops;
+        // compiled after jit_threshold_ runs. the native code runs only
+        // when the batch has native_cycles left
+        NativeBlock native = nullptr;
+        int native_cycles = 0;
+        int run_count = 0;
+    };
+    static constexpr int BLOCK_COUNT = 4096;
+    std::vector<CodeBlock> blocks_;
+    CpuEngine engine_ = CPU_ENGINE_BLOCK;
+    static constexpr int JIT_THRESHOLD = 16;
+    int jit_threshold_ = JIT_THRESHOLD;
+    static constexpr size_t JIT_BUFFER_SIZE = 4 << 20;
+    std::unique_ptr<CodeBuffer> jit_buffer_;
+    std::unique_ptr<X64Emitter> jit_emitter_;
+
+    // frame stats
+    CpuFrameStats frame_stats_;
+    bool in_nmi_ = false;
+    uint64_t nmi_cycle_ = 0;
+    uint64_t write_count_ = 0;
+    uint16_t spin_target_ = 0;
+    uint64_t spin_cycle_ = 0;
+    uint64_t spin_write_count_ = 0;
+    AccessCounter *access_ = nullptr;
+    InputLatency *latency_ = nullptr;
+
     // serialization
     friend void Serialize(Archive &ar, const std::string &name, CPU *data)
     {
+        // p_ is written with all flags. RestoreState() splits them on load
+        data->p_ = data->get_p();
+
         SERIALIZE_NAMESPACE_BEGIN(ar, name);
         SERIALIZE(ar, data, total_cycles_);
         SERIALIZE(ar, data, suspended_);
@@ -81,18 +215,46 @@ private:
         SERIALIZE_NAMESPACE_END(ar);
     }
 
+    friend void HashState(StateHash &h, const CPU *data)
+    {
+        const uint8_t p = data->get_p();
+
+        HASH_STATE(h, data, total_cycles_);
+        HASH_STATE(h, data, suspended_);
+        HASH_STATE(h, data, a_);
+        HASH_STATE(h, data, x_);
+        HASH_STATE(h, data, y_);
+        HASH_STATE(h, data, s_);
+        HashState(h, &p);
+        HASH_STATE(h, data, pc_);
+        HASH_STATE(h, data, wram_);
+    }
+
     // read and write
+    void init_pages();
+    void update_prg_pages();
     void write_byte(uint16_t addr, uint8_t data);
     uint8_t read_byte(uint16_t addr);
+    void write_ppu(uint16_t addr, uint8_t data);
+    uint8_t read_ppu(uint16_t addr);
+    void write_io(uint16_t addr, uint8_t data);
+    uint8_t read_io(uint16_t addr);
+    void write_cart(uint16_t addr, uint8_t data);
+    uint8_t read_cart(uint16_t addr);
     uint16_t read_word(uint16_t addr);
     uint8_t peek_byte(uint16_t addr) const;
     uint16_t peek_word(uint16_t addr) const;
     uint8_t fetch();
     uint16_t fetch_word();
+    bool is_direct_read(uint16_t addr) const;
+    uint8_t peek_direct(uint16_t addr) const;
+    uint16_t peek_direct_word(uint16_t addr) const;
     // address
     uint16_t abs_indirect(uint16_t abs) const;
     uint16_t zp_indirect(uint8_t zp) const;
-    uint16_t fetch_address(int mode, bool *page_crossed);
+    template<int Mode> uint16_t fetch_operand();
+    template<int Mode> uint16_t get_address(uint16_t operand, bool &page_crossed) const;
+    template<int Mode> uint16_t peek_address() const;
     // flags and registers
     void set_pc(uint16_t addr);
     void set_flag(uint8_t flag, uint8_t val);
@@ -103,6 +265,7 @@ private:
     void set_y(uint8_t val);
     void set_s(uint8_t val);
     void set_p(uint8_t val);
+    uint8_t get_p() const;
     // push and pop
     void push(uint8_t val);
     uint8_t pop();
@@ -110,10 +273,46 @@ private:
     uint16_t pop_word();
     void compare(uint8_t a, uint8_t b);
     bool branch_if(uint16_t addr, bool cond);
+    void count_spin(uint16_t target);
     void add_a_m(uint8_t data);
-    // instruction
-    int execute(Instruction inst);
+    // instruction. a handler per opcode with its operation, addressing
+    // mode and cycles resolved at compile time
+    using Handler = int (*)(CPU &cpu);
+    using HandlerTable = std::array<Handler,256>;
+    template<int Oper, int Mode> void operate(uint16_t addr);
+    template<int Oper> bool branch_condition() const;
+    template<int Code> int execute();
+    template<int Code> int execute_operand(uint16_t operand);
+    template<int Code> static int dispatch(CPU &cpu);
+    template<int... Codes>
+    static constexpr HandlerTable make_handlers(std::integer_sequence<int,Codes...>);
     int execute_instruction();
+    // decoded blocks
+    using DecodedHandlerTable = std::array<DecodedHandler,256>;
+    template<int Code> static int dispatch_decoded(CPU &cpu, uint16_t operand);
+    template<int... Codes>
+    static constexpr DecodedHandlerTable make_decoded_handlers(std::integer_sequence<int,Codes...>);
+    static DecodedHandler get_decoded_handler(uint8_t code);
+    const CodeBlock *find_block();
+    void decode_block(CodeBlock &block, uint16_t pc, const uint8_t *code);
+    void clear_blocks();
+    bool run_block(const CodeBlock &block, uint64_t target_cycle, int &cycles);
+    int run_decoded(const DecodedOp &op);
+    // native code
+    void compile_block(CodeBlock &block);
+    void flush_jit();
+    bool interrupt_pending() const;
+    static void count_spin_native(CPU *cpu, uint16_t target);
+    // tells if the instruction at PC accesses memory other than RAM and
+    // PRG ROM pages. reads nothing else
+    using IoCheck = bool (*)(const CPU &cpu);
+    using IoCheckTable = std::array<IoCheck,256>;
+    template<int Code> bool accesses_io() const;
+    template<int Code> static bool check_io(const CPU &cpu);
+    template<int... Codes>
+    static constexpr IoCheckTable make_io_checks(std::integer_sequence<int,Codes...>);
+    static IoCheck get_io_check(uint8_t code);
+    bool next_accesses_io() const;
     // interrupts
     int do_interrupt(uint16_t vector);
     int handle_interrupt();
@@ -0,0 +1,483 @@
+#include "cpu.h"
+#include "instruction_table.h"
+#include "jit.h"
+#include "hooks.h"
+
+namespace nes {
+
+// Hot PRG ROM blocks compiled to x86-64 code for CPU_ENGINE_JIT.
+//
+// The code of a block runs its ops up to the first one that may access
+// I/O or clear the I flag. run_block() interprets the rest. Only those
+// ops make an interrupt pending in a batch, so the code does not check
+// for interrupts. It does not check the batch target either. run_block()
+// calls it only when the block ends before the target.
+//
+// Registers and flags stay in the CPU. rbx points to it and each op
+// loads and stores what it uses. Ops without a native form call their
+// decoded handler.
+
+// byte offsets of the CPU members the code uses
+struct CpuLayout {
+    int32_t a, x, y, s, p, pc;
+    int32_t z_result, n_result, carry;
+    int32_t wram;
+    int32_t total_cycles, write_count;
+};
+
+// a byte of RAM the op reads or writes. [rbx + rdx + disp] if indexed
+struct MemRef {
+    int32_t disp = 0;
+    bool indexed = false;
+};
+
+// the ops that end a native run. the rest of the block is interpreted
+static constexpr bool stops_native(int oper)
+{
+    return oper == CLI || oper == PLP || oper == RTI || oper == BRK;
+}
+
+// modes with a fixed cycle count. absolute addresses are RAM here
+static constexpr bool is_native_mode(int mode)
+{
+    return mode == IMP || mode == ACC || mode == IMM || mode == REL ||
+           mode == ZPG || mode == ZPX || mode == ZPY || mode == ABS;
+}
+
+static bool has_native_code(int oper, int mode)
+{
+    if (!is_native_mode(mode))
+        return false;
+
+    switch (oper) {
+    case LDA: case LDX: case LDY: case LAX:
+    case STA: case STX: case STY: case SAX:
+    case TAX: case TAY: case TSX: case TXA: case TXS: case TYA:
+    case PHA: case PLA:
+    case ASL: case LSR: case ROL: case ROR:
+    case AND: case EOR: case ORA: case BIT:
+    case ADC: case SBC: case CMP: case CPX: case CPY:
+    case INC: case INX: case INY: case DEC: case DEX: case DEY:
+    case JMP:
+    case CLC: case CLD: case CLV: case SEC: case SED: case SEI:
+    case NOP:
+        return true;
+
+    default:
+        return is_branch(oper);
+    }
+}
+
+static MemRef get_mem_ref(X64Emitter &e, const CpuLayout &m, int mode, uint16_t operand)
+{
+    MemRef ref;
+
+    switch (mode) {
+    case ZPG:
+        ref.disp = m.wram + (operand & 0xFF);
+        break;
+
+    case ZPX: case ZPY:
+        // dl wraps in the zero page
+        e.LoadByte(RDX, mode == ZPX ? m.x : m.y);
+        e.AluImm(X64_ADD_IMM, RDX, operand);
+        ref.disp = m.wram;
+        ref.indexed = true;
+        break;
+
+    default:
+        // ABS below $2000. 3 of the 4 2KB rams are mirroring
+        ref.disp = m.wram + (operand & 0x07FF);
+        break;
+    }
+
+    return ref;
+}
+
+// the operand value to cl
+static void load_operand(X64Emitter &e, const CpuLayout &m, int mode, uint16_t operand)
+{
+    if (mode == IMM) {
+        e.MovImm(RCX, operand & 0xFF);
+        return;
+    }
+
+    const MemRef ref = get_mem_ref(e, m, mode, operand);
+    e.LoadByte(RCX, ref.disp, ref.indexed);
+}
+
+static void update_zn(X64Emitter &e, const CpuLayout &m, int reg)
+{
+    e.StoreByte(reg, m.z_result);
+    e.StoreByte(reg, m.n_result);
+}
+
+static void count_write(X64Emitter &e, const CpuLayout &m)
+{
+    if (DebugHooks::stats)
+        e.IncMem64(m.write_count);
+}
+
+static int32_t get_register(const CpuLayout &m, int oper)
+{
+    switch (oper) {
+    case LDX: case STX: case CPX: case INX: case DEX: return m.x;
+    case LDY: case STY: case CPY: case INY: case DEY: return m.y;
+    default: return m.a;
+    }
+}
+
+static void emit_exit(X64Emitter &e, int op_count)
+{
+    e.MovImm(RAX, op_count);
+    e.Epilogue();
+}
+
+// ops other than jumps and branches
+static void emit_op(X64Emitter &e, const CpuLayout &m, int oper, int mode, uint16_t operand)
+{
+    switch (oper) {
+    case LDA: case LDX: case LDY:
+        load_operand(e, m, mode, operand);
+        e.StoreByte(RCX, get_register(m, oper));
+        update_zn(e, m, RCX);
+        break;
+
+    case LAX:
+        load_operand(e, m, mode, operand);
+        e.StoreByte(RCX, m.a);
+        e.StoreByte(RCX, m.x);
+        update_zn(e, m, RCX);
+        break;
+
+    case STA: case STX: case STY: case SAX:
+        {
+            const MemRef ref = get_mem_ref(e, m, mode, operand);
+            if (oper == SAX) {
+                e.LoadByte(RAX, m.a);
+                e.LoadByte(RCX, m.x);
+                e.Alu(X64_AND, RAX, RCX);
+            }
+            else {
+                e.LoadByte(RAX, get_register(m, oper));
+            }
+            e.StoreByte(RAX, ref.disp, ref.indexed);
+            count_write(e, m);
+        }
+        break;
+
+    case TAX: case TAY: case TSX: case TXA: case TXS: case TYA:
+        {
+            const int32_t src = oper == TAX || oper == TAY ? m.a :
+                                oper == TSX ? m.s :
+                                oper == TYA ? m.y : m.x;
+            const int32_t dst = oper == TAX || oper == TSX ? m.x :
+                                oper == TAY ? m.y :
+                                oper == TXS ? m.s : m.a;
+            e.LoadByte(RAX, src);
+            e.StoreByte(RAX, dst);
+            if (oper != TXS)
+                update_zn(e, m, RAX);
+        }
+        break;
+
+    case PHA:
+        e.LoadByte(RDX, m.s);
+        e.LoadByte(RAX, m.a);
+        e.StoreByte(RAX, m.wram + 0x100, true);
+        e.DecMem(m.s);
+        count_write(e, m);
+        break;
+
+    case PLA:
+        e.IncMem(m.s);
+        e.LoadByte(RDX, m.s);
+        e.LoadByte(RCX, m.wram + 0x100, true);
+        e.StoreByte(RCX, m.a);
+        update_zn(e, m, RCX);
+        break;
+
+    case ASL: case LSR: case ROL: case ROR:
+        {
+            MemRef ref;
+            if (mode == ACC)
+                ref.disp = m.a;
+            else
+                ref = get_mem_ref(e, m, mode, operand);
+
+            if (oper == ROL || oper == ROR) {
+                // carry in to CF
+                e.LoadByte(RAX, m.carry);
+                e.AluImm(X64_ADD_IMM, RAX, 0xFF);
+            }
+            e.LoadByte(RCX, ref.disp, ref.indexed);
+            e.Shift(oper == ASL ? X64_SHL : oper == LSR ? X64_SHR :
+                    oper == ROL ? X64_RCL : X64_RCR, RCX);
+            e.SetCond(X64_B, m.carry);
+            e.StoreByte(RCX, ref.disp, ref.indexed);
+            update_zn(e, m, RCX);
+            if (mode != ACC)
+                count_write(e, m);
+        }
+        break;
+
+    case AND: case EOR: case ORA:
+        load_operand(e, m, mode, operand);
+        e.LoadByte(RAX, m.a);
+        e.Alu(oper == AND ? X64_AND : oper == EOR ? X64_XOR : X64_OR, RAX, RCX);
+        e.StoreByte(RAX, m.a);
+        update_zn(e, m, RAX);
+        break;
+
+    case BIT:
+        load_operand(e, m, mode, operand);
+        e.LoadByte(RAX, m.a);
+        e.Alu(X64_AND, RAX, RCX);
+        e.StoreByte(RAX, m.z_result);
+        e.StoreByte(RCX, m.n_result);
+        // V from bit 6
+        e.AluImm(X64_AND_IMM, RCX, 0x40);
+        e.AluMemImm(X64_AND_IMM, m.p, ~0x40);
+        e.AluToMem(X64_OR, m.p, RCX);
+        break;
+
+    case ADC: case SBC:
+        // SBC adds ~M like add_a_m(). adc sets C and V the same way
+        load_operand(e, m, mode, operand);
+        if (oper == SBC)
+            e.Not(RCX);
+        e.LoadByte(RAX, m.a);
+        e.LoadByte(RDX, m.carry);
+        e.AluImm(X64_ADD_IMM, RDX, 0xFF);
+        e.Alu(X64_ADC, RAX, RCX);
+        e.SetCond(X64_B, m.carry);
+        e.SetCondReg(X64_O, RDX);
+        e.StoreByte(RAX, m.a);
+        update_zn(e, m, RAX);
+        e.Shift(X64_SHL, RDX, 6);
+        e.AluMemImm(X64_AND_IMM, m.p, ~0x40);
+        e.AluToMem(X64_OR, m.p, RDX);
+        break;
+
+    case CMP: case CPX: case CPY:
+        load_operand(e, m, mode, operand);
+        e.LoadByte(RAX, get_register(m, oper));
+        e.Alu(X64_CMP, RAX, RCX);
+        e.SetCond(X64_AE, m.carry);
+        e.Alu(X64_SUB, RAX, RCX);
+        update_zn(e, m, RAX);
+        break;
+
+    case INC: case DEC:
+        {
+            const MemRef ref = get_mem_ref(e, m, mode, operand);
+            e.LoadByte(RCX, ref.disp, ref.indexed);
+            if (oper == INC)
+                e.Inc(RCX);
+            else
+                e.Dec(RCX);
+            e.StoreByte(RCX, ref.disp, ref.indexed);
+            update_zn(e, m, RCX);
+            count_write(e, m);
+        }
+        break;
+
+    case INX: case INY: case DEX: case DEY:
+        e.LoadByte(RAX, get_register(m, oper));
+        if (oper == INX || oper == INY)
+            e.Inc(RAX);
+        else
+            e.Dec(RAX);
+        e.StoreByte(RAX, get_register(m, oper));
+        update_zn(e, m, RAX);
+        break;
+
+    case CLC: e.StoreByteImm(m.carry, 0); break;
+    case SEC: e.StoreByteImm(m.carry, 1); break;
+    case CLD: e.AluMemImm(X64_AND_IMM, m.p, ~0x08); break;
+    case SED: e.AluMemImm(X64_OR_IMM, m.p, 0x08); break;
+    case CLV: e.AluMemImm(X64_AND_IMM, m.p, ~0x40); break;
+    case SEI: e.AluMemImm(X64_OR_IMM, m.p, 0x04); break;
+
+    default:
+        // NOP
+        break;
+    }
+}
+
+// jumps to the label if the branch is not taken
+static size_t emit_branch_not_taken(X64Emitter &e, const CpuLayout &m, int oper)
+{
+    switch (oper) {
+    case BCC: case BCS:
+        e.AluMemImm(X64_CMP_IMM, m.carry, 0);
+        return e.JumpIf(oper == BCS ? X64_E : X64_NE);
+
+    case BEQ: case BNE:
+        // Z if z_result_ is 0
+        e.AluMemImm(X64_CMP_IMM, m.z_result, 0);
+        return e.JumpIf(oper == BEQ ? X64_NE : X64_E);
+
+    case BMI: case BPL:
+        e.TestMemImm(m.n_result, 0x80);
+        return e.JumpIf(oper == BMI ? X64_E : X64_NE);
+
+    default:
+        // BVC, BVS
+        e.TestMemImm(m.p, 0x40);
+        return e.JumpIf(oper == BVS ? X64_E : X64_NE);
+    }
+}
+
+void CPU::count_spin_native(CPU *cpu, uint16_t target)
+{
+    cpu->count_spin(target);
+}
+
+void CPU::compile_block(CodeBlock &block)
+{
+    auto offset = [this](const void *member) {
+        return static_cast<int32_t>(static_cast<const uint8_t*>(member) -
+                                    reinterpret_cast<const uint8_t*>(this));
+    };
+
+    CpuLayout m;
+    m.a = offset(&a_);
+    m.x = offset(&x_);
+    m.y = offset(&y_);
+    m.s = offset(&s_);
+    m.p = offset(&p_);
+    m.pc = offset(&pc_);
+    m.z_result = offset(&z_result_);
+    m.n_result = offset(&n_result_);
+    m.carry = offset(&carry_);
+    m.wram = offset(wram_.data());
+    m.total_cycles = offset(&total_cycles_);
+    m.write_count = offset(&write_count_);
+
+    // ops up to one that may access I/O or clear the I flag
+    int count = 0;
+    while (count < block.count) {
+        const DecodedOp &op = block.ops[count];
+        if (op.check_io || stops_native(operation_table[op.code]))
+            break;
+        count++;
+    }
+    if (count == 0)
+        return;
+
+    X64Emitter &e = *jit_emitter_;
+    e.Clear();
+    e.Prologue();
+
+    uint16_t pc = block.pc;
+    int max_cycles = 0;
+    // cycles of native ops added at once
+    int pending_cycles = 0;
+
+    auto add_cycles = [&e, &m, &pending_cycles]() {
+        if (pending_cycles > 0)
+            e.AddMem64Imm(m.total_cycles, pending_cycles);
+        pending_cycles = 0;
+    };
+
+    bool exited = false;
+
+    for (int i = 0; i < count; i++) {
+        const DecodedOp &op = block.ops[i];
+        const int oper = operation_table[op.code];
+        const int mode = addr_mode_table[op.code];
+        const int cycles = cycle_table[op.code];
+        const uint16_t next_pc = pc + op.bytes;
+
+        if (!has_native_code(oper, mode)) {
+            // the handler reads PC and returns the cycles with any page
+            // crossing
+            add_cycles();
+            e.StoreWordImm(m.pc, pc);
+            e.Mov(RDI, RBX);
+            e.MovImm(RSI, op.operand);
+            e.Call(reinterpret_cast<uintptr_t>(op.handler));
+            e.Mov32(RAX, RAX);
+            e.AddMem64Reg(m.total_cycles, RAX);
+            max_cycles += cycles + 1;
+
+            if (ends_block(oper)) {
+                // JSR and RTS set PC
+                emit_exit(e, block.count);
+                exited = true;
+            }
+        }
+        else if (oper == JMP || is_branch(oper)) {
+            const uint16_t target = oper == JMP ? op.operand :
+                                    next_pc + static_cast<int8_t>(op.operand);
+            const bool page_crossed = (next_pc & 0xFF00) != (target & 0xFF00);
+            add_cycles();
+
+            size_t not_taken = 0;
+            if (is_branch(oper))
+                not_taken = emit_branch_not_taken(e, m, oper);
+
+            if (DebugHooks::stats) {
+                // count_spin() reads PC at the next instruction
+                e.StoreWordImm(m.pc, next_pc);
+                e.Mov(RDI, RBX);
+                e.MovImm(RSI, target);
+                e.Call(reinterpret_cast<uintptr_t>(&CPU::count_spin_native));
+            }
+            e.StoreWordImm(m.pc, target);
+            e.AddMem64Imm(m.total_cycles, oper == JMP ? cycles : cycles + 1 + page_crossed);
+            emit_exit(e, block.count);
+
+            if (is_branch(oper)) {
+                e.Bind(not_taken);
+                e.StoreWordImm(m.pc, next_pc);
+                e.AddMem64Imm(m.total_cycles, cycles);
+                emit_exit(e, block.count);
+            }
+
+            max_cycles += is_branch(oper) ? cycles + 2 : cycles;
+            exited = true;
+        }
+        else {
+            emit_op(e, m, oper, mode, op.operand);
+            pending_cycles += cycles;
+            max_cycles += cycles;
+        }
+
+        pc = next_pc;
+    }
+
+    if (!exited) {
+        // at the op interpreted next, or the next block
+        add_cycles();
+        e.StoreWordImm(m.pc, pc);
+        emit_exit(e, count);
+    }
+
+    const void *code = jit_buffer_->Add(e.GetCode());
+    if (!code) {
+        // full. starts over with the hot blocks of now
+        flush_jit();
+        code = jit_buffer_->Add(e.GetCode());
+        if (!code)
+            return;
+    }
+
+    block.native = reinterpret_cast<NativeBlock>(const_cast<void*>(code));
+    block.native_cycles = max_cycles;
+}
+
+void CPU::flush_jit()
+{
+    for (CodeBlock &block: blocks_) {
+        block.native = nullptr;
+        block.native_cycles = 0;
+        block.run_count = 0;
+    }
+
+    if (jit_buffer_)
+        jit_buffer_->Clear();
+}
+
+} // namespace
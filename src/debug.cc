@@ -1,33 +1,24 @@
 #include <cstdint>
+#include <cmath>
 #include <string>
 #include "debug.h"
 #include "disassemble.h"
+#include "exec_trace.h"
 #include "framebuffer.h"
 #include "cartridge.h"
 #include "sound.h"
 #include "nes.h"
 #include "cpu.h"
 #include "ppu.h"
+#include "heatmap.h"
 
 namespace nes {
 
 void PrintCpuStatus(const CPU &cpu, const PPU &ppu)
 {
-    const CpuStatus stat = cpu.GetStatus();
-    const Code line = DisassembleLine(cpu, stat.pc);
-    const std::string code_str = GetCodeString(line);
-    const std::string mem_str = GetMemoryString(line, cpu);
-    const int padding = 48 - code_str.length() - mem_str.length();
-
-    printf("%s%s", code_str.c_str(), mem_str.c_str());
-    printf("%*s", padding, " ");
-    printf("A:%02X X:%02X Y:%02X P:%02X SP:%02X",
-            stat.a, stat.x, stat.y, stat.p, stat.s);
-
-    printf(" PPU:%3d,%3d", ppu.GetScanline(), ppu.GetCycle());
-
-    printf(" CYC:%llu", cpu.GetTotalCycles());
-    printf("\n");
+    ExecRecord rec;
+    CaptureExecRecord(cpu, ppu, rec);
+    printf("%s\n", FormatExecRecord(rec).c_str());
 }
 
 void print_cpu_status_style_1(const CPU &cpu, const PPU &ppu)
@@ -175,4 +166,33 @@ void LoadOamTable(FrameBuffer &fb, const PPU &ppu)
     }
 }
 
+void LoadHeatmap(FrameBuffer &fb, const AccessCounter &counter)
+{
+    const int W = fb.Width();
+    const int H = fb.Height();
+    double log_max[ACCESS_TYPE_COUNT] = {0};
+
+    for (int type = 0; type < ACCESS_TYPE_COUNT; type++)
+        log_max[type] = std::log(1. + counter.GetMax(type));
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            const uint16_t addr = y * W + x;
+            uint8_t level[ACCESS_TYPE_COUNT] = {0};
+
+            for (int type = 0; type < ACCESS_TYPE_COUNT; type++) {
+                const uint32_t count = counter.Get(type, addr);
+                if (count > 0)
+                    level[type] = 64 + 191 * std::log(1. + count) / log_max[type];
+            }
+
+            Color col;
+            col.r = level[ACCESS_WRITE];
+            col.g = level[ACCESS_READ];
+            col.b = level[ACCESS_EXECUTE];
+            fb.SetColor(x, y, col);
+        }
+    }
+}
+
 } // namespace
@@ -8,12 +8,16 @@ class Cartridge;
 class CPU;
 class PPU;
 class NES;
+class AccessCounter;
 
 void PrintCpuStatus(const CPU &cpu, const PPU &ppu);
 void LogCpuStatus(NES &nes, int max_lines);
 
 void LoadPatternTable(FrameBuffer &fb, const Cartridge *cart);
 void LoadOamTable(FrameBuffer &fb, const PPU &ppu);
+// a pixel per address from left to right and top to bottom.
+// red for writes, green for reads and blue for executes in log scale
+void LoadHeatmap(FrameBuffer &fb, const AccessCounter &counter);
 
 } // namespace
 
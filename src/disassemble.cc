@@ -168,10 +168,9 @@ std::string GetCodeString(const Code &code)
     return result;
 }
 
-std::string GetMemoryString(const Code &code, const CPU &cpu)
+MemoryRef PeekMemoryRef(const Code &code, const CPU &cpu)
 {
-    constexpr size_t SIZE = 32;
-    char buf[SIZE] = {'\0'};
+    MemoryRef ref;
     const uint8_t lo = code.lo;
     const uint16_t wd = code.word;
 
@@ -181,49 +180,102 @@ std::string GetMemoryString(const Code &code, const CPU &cpu)
 
     switch (code.instruction.addr_mode) {
     case IND:
-        snprintf(buf, SIZE, " = %04X", cpu.GetAbsoluteIndirect(wd));
+        ref.pointer = cpu.GetAbsoluteIndirect(wd);
+        break;
+
+    case ABS:
+        if (code.instruction.operation != JMP && code.instruction.operation != JSR)
+            ref.value = cpu.PeekData(wd);
+        break;
+
+    case ABX:
+        ref.value = cpu.PeekData(wd + x);
+        break;
+
+    case ABY:
+        ref.value = cpu.PeekData((wd + y) & 0xFFFF);
+        break;
+
+    case IZX:
+        ref.pointer = cpu.GetZeroPageIndirect(lo + x);
+        ref.value = cpu.PeekData(ref.pointer);
+        break;
+
+    case IZY:
+        ref.pointer = cpu.GetZeroPageIndirect(lo);
+        ref.value = cpu.PeekData(ref.pointer + y);
+        break;
+
+    case ZPX:
+        ref.value = cpu.PeekData((lo + x) & 0xFF);
+        break;
+
+    case ZPY:
+        ref.value = cpu.PeekData((lo + y) & 0xFF);
+        break;
+
+    case ZPG:
+        ref.value = cpu.PeekData(lo);
+        break;
+
+    default:
+        break;
+    }
+
+    return ref;
+}
+
+std::string GetMemoryString(const Code &code, const CPU &cpu)
+{
+    const CpuStatus stat = cpu.GetStatus();
+
+    return GetMemoryString(code, stat.x, stat.y, PeekMemoryRef(code, cpu));
+}
+
+std::string GetMemoryString(const Code &code, uint8_t x, uint8_t y, const MemoryRef &ref)
+{
+    constexpr size_t SIZE = 32;
+    char buf[SIZE] = {'\0'};
+    const uint8_t lo = code.lo;
+    const uint16_t wd = code.word;
+
+    switch (code.instruction.addr_mode) {
+    case IND:
+        snprintf(buf, SIZE, " = %04X", ref.pointer);
         break;
 
     case ABS:
         if (code.instruction.operation != JMP && code.instruction.operation != JSR)
-            snprintf(buf, SIZE, " = %02X", cpu.PeekData(wd));
+            snprintf(buf, SIZE, " = %02X", ref.value);
         break;
 
     case ABX:
-        snprintf(buf, SIZE, " @ %04X = %02X", wd + x, cpu.PeekData(wd + x));
+        snprintf(buf, SIZE, " @ %04X = %02X", wd + x, ref.value);
         break;
 
     case ABY:
-        snprintf(buf, SIZE, " @ %04X = %02X",
-                (wd + y) & 0xFFFF, cpu.PeekData((wd + y) & 0xFFFF));
+        snprintf(buf, SIZE, " @ %04X = %02X", (wd + y) & 0xFFFF, ref.value);
         break;
 
     case IZX:
-        {
-            const uint16_t zpi = cpu.GetZeroPageIndirect(lo + x);
-            snprintf(buf, SIZE, " @ %02X = %04X = %02X",
-                    (lo + x) & 0xFF, zpi, cpu.PeekData(zpi));
-        }
+        snprintf(buf, SIZE, " @ %02X = %04X = %02X", (lo + x) & 0xFF, ref.pointer, ref.value);
         break;
 
     case IZY:
-        {
-            const uint16_t zpi = cpu.GetZeroPageIndirect(lo);
-            snprintf(buf, SIZE, " = %04X @ %04X = %02X",
-                    zpi, (zpi + y) & 0xFFFF, cpu.PeekData(zpi + y));
-        }
+        snprintf(buf, SIZE, " = %04X @ %04X = %02X",
+                ref.pointer, (ref.pointer + y) & 0xFFFF, ref.value);
         break;
 
     case ZPX:
-        snprintf(buf, SIZE, " @ %02X = %02X", (lo + x) & 0xFF, cpu.PeekData((lo + x) & 0xFF));
+        snprintf(buf, SIZE, " @ %02X = %02X", (lo + x) & 0xFF, ref.value);
         break;
 
     case ZPY:
-        snprintf(buf, SIZE, " @ %02X = %02X", (lo + y) & 0xFF, cpu.PeekData((lo + y) & 0xFF));
+        snprintf(buf, SIZE, " @ %02X = %02X", (lo + y) & 0xFF, ref.value);
         break;
 
     case ZPG:
-        snprintf(buf, SIZE, " = %02X", cpu.PeekData(lo));
+        snprintf(buf, SIZE, " = %02X", ref.value);
         break;
 
     default:
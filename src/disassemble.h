@@ -35,9 +35,17 @@ private:
     std::unordered_map<uint32_t,size_t> addr_to_code_;
 };
 
+// memory the instruction refers to, read before it runs
+struct MemoryRef {
+    uint16_t pointer = 0;
+    uint8_t value = 0;
+};
+
 Code DisassembleLine(const CPU &cpu, uint16_t addr);
+MemoryRef PeekMemoryRef(const Code &code, const CPU &cpu);
 std::string GetCodeString(const Code &code);
 std::string GetMemoryString(const Code &code, const CPU &cpu);
+std::string GetMemoryString(const Code &code, uint8_t x, uint8_t y, const MemoryRef &ref);
 
 } // namespace
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <GLFW/glfw3.h>
 #include "display.h"
@@ -8,6 +9,9 @@
 #include "state.h"
 #include "nes.h"
 #include "ppu.h"
+#include "profile.h"
+#include "trace.h"
+#include "hooks.h"
 
 namespace nes {
 
@@ -27,6 +31,9 @@ struct KeyState {
 static const GLuint main_screen = 0;
 static GLuint pattern_table_id = 0;
 static GLuint oam_table_id = 0;
+static GLuint heatmap_id = 0;
+static FrameBuffer cpu_heatmap;
+static FrameBuffer ppu_heatmap;
 
 struct Coord {
     float x = 0.f, y = 0.f;
@@ -51,6 +58,9 @@ static int focused_oam_index = -1;
 static int font_w = 8;
 static int font_h = 8;
 
+// ticks spent in transfer_texture() in the current frame
+static uint64_t texture_ticks = 0;
+
 static void transfer_texture(const FrameBuffer &fb);
 static void resize(GLFWwindow *window, int width, int height);
 static void cursor_position(GLFWwindow *window, double xpos, double ypos);
@@ -63,14 +73,18 @@ enum TextDecoration {
     TEXT_OUTLINE,
 };
 
-static void draw_text(const std::string &text, int x, int y);
-static void draw_text(const std::string &text, int x, int y, TextDecoration deco);
+static void draw_text(const char *text, int x, int y);
+static void draw_text(const char *text, int x, int y, TextDecoration deco);
 
 Display::Display(NES &nes) : nes_(nes)
 {
     // Init bitmap fonts
     InitBitmapFont();
     GetBitmapFontSize(font_w, font_h);
+
+    // a pixel per address
+    cpu_heatmap.Resize(256, 0x10000 / 256);
+    ppu_heatmap.Resize(256, 0x4000 / 256);
 }
 
 Display::~Display()
@@ -104,24 +118,50 @@ int Display::Open()
     resize(window, WINX, WINY);
     key.window = window;
 
+    FrameProfile prof;
+
     // Loop until the user closes the window
     while (!glfwWindowShouldClose(window)) {
         glfwSetTime(0.0);
+        const uint64_t frame_start = GetProfileTicks();
+        const bool use_metrics = show_metrics_ || metrics_.IsCsvOpen();
+        const std::array<uint64_t,PHASE_COUNT> start_ticks = prof.ticks;
 
         // Update framebuffer
-        nes_.UpdateFrame();
+        if (use_metrics)
+            nes_.UpdateFrame(prof);
+        else
+            nes_.UpdateFrame();
+
+        if (show_heatmap_ && nes_.IsRunning())
+            heatmap_.EndFrame();
 
         // Render here
+        texture_ticks = 0;
         render();
 
         // Render overlay
+        const uint64_t overlay_start = GetProfileTicks();
         render_overlay(glfwGetTime());
+        const uint64_t overlay_ticks = GetProfileTicks() - overlay_start;
 
         // Swap front and back buffers
-        glfwSwapBuffers(window);
+        {
+            TRACE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
+
+        // Latency ends when the frame is presented
+        InputLatency *latency = nes_.GetLatencyProbe();
+        if (latency)
+            latency->Present(GetProfileTicks());
 
         // Poll for and process events
-        glfwPollEvents();
+        {
+            TRACE_SCOPE("glfwPollEvents");
+            glfwPollEvents();
+        }
+        const uint64_t poll_ticks = GetProfileTicks();
 
         // Inputs
         uint8_t input = 0x00;
@@ -153,6 +193,12 @@ int Display::Open()
         else if (key.IsPressed(GLFW_KEY_O)) {
             show_oam_ = !show_oam_;
         }
+        else if (key.IsPressed(GLFW_KEY_M)) {
+            show_metrics_ = !show_metrics_;
+        }
+        else if (key.IsPressed(GLFW_KEY_H)) {
+            toggle_heatmap();
+        }
         // Keys sound channels
         else if (key.IsPressed(GLFW_KEY_1)) {
             toggle_channel_bits(0x01);
@@ -217,6 +263,16 @@ int Display::Open()
             else
                 set_status_message(stat_filename + ": failed to load");
         }
+        else if (key.IsPressed(GLFW_KEY_F3)) {
+            const Cartridge *cart = nes_.GetCartridge();
+            const std::string heat_filename = cart->GetFileName() + ".heat";
+            if (!show_heatmap_)
+                set_status_message("heatmap is off. press H to turn on");
+            else if (heatmap_.SaveWindow(heat_filename))
+                set_status_message(heat_filename + ": saved successfully");
+            else
+                set_status_message(heat_filename + ": failed to save");
+        }
         // Keys reset
         else if (key.IsPressed(GLFW_KEY_R)) {
             nes_.PushResetButton();
@@ -228,31 +284,56 @@ int Display::Open()
         // Gamepad
         GLFWgamepadstate state;
         if (glfwGetGamepadState(GLFW_JOYSTICK_1, &state)) {
-            uint8_t input = 0x00;
+            uint8_t pad_input = 0x00;
 
             if (state.buttons[GLFW_GAMEPAD_BUTTON_B])
-                input |= 1 << 7; // A
+                pad_input |= 1 << 7; // A
             if (state.buttons[GLFW_GAMEPAD_BUTTON_A])
-                input |= 1 << 6; // B
+                pad_input |= 1 << 6; // B
             if (state.buttons[GLFW_GAMEPAD_BUTTON_BACK])
-                input |= 1 << 5; // select
+                pad_input |= 1 << 5; // select
             if (state.buttons[GLFW_GAMEPAD_BUTTON_START])
-                input |= 1 << 4; // start
+                pad_input |= 1 << 4; // start
             if (state.axes[GLFW_GAMEPAD_AXIS_LEFT_Y] == -1)
-                input |= 1 << 3; // up
+                pad_input |= 1 << 3; // up
             if (state.axes[GLFW_GAMEPAD_AXIS_LEFT_Y] == 1)
-                input |= 1 << 2; // down
+                pad_input |= 1 << 2; // down
             if (state.axes[GLFW_GAMEPAD_AXIS_LEFT_X] == -1)
-                input |= 1 << 1; // left
+                pad_input |= 1 << 1; // left
             if (state.axes[GLFW_GAMEPAD_AXIS_LEFT_X] == 1)
-                input |= 1 << 0; // right
-            if (input)
+                pad_input |= 1 << 0; // right
+            if (pad_input) {
+                input = pad_input;
                 nes_.InputController(0, input);
+            }
+        }
+
+        // Latency
+        if (latency)
+            latency->Press(input, poll_ticks);
+
+        // Metrics
+        if (use_metrics) {
+            FrameTimes times;
+            GetPhaseTimes(prof, start_ticks, times);
+            times.ms[METRIC_TEXTURE] = TicksToMs(texture_ticks);
+            times.ms[METRIC_OVERLAY] = TicksToMs(overlay_ticks);
+            times.ms[METRIC_FRAME] = TicksToMs(GetProfileTicks() - frame_start);
+
+            const AudioFrameStats &audio = nes_.GetAudioFrameStats();
+            times.ms[METRIC_OPENAL] = TicksToMs(audio.al_ticks);
+
+            FrameUsage usage;
+            GetFrameUsage(nes_.cpu, usage);
+            metrics_.AddFrame(times, usage, audio);
         }
 
         frame_++;
     }
 
+    if (show_heatmap_)
+        toggle_heatmap();
+
     glfwTerminate();
     return 0;
 }
@@ -276,6 +357,12 @@ void Display::init_video()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
+    // memory heatmap
+    glGenTextures(1, &heatmap_id);
+    glBindTexture(GL_TEXTURE_2D, heatmap_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
     glBindTexture(GL_TEXTURE_2D, main_screen);
     // bg color
     constexpr float bg = .25;
@@ -284,6 +371,8 @@ void Display::init_video()
 
 void Display::render() const
 {
+    TRACE_SCOPE("render");
+
     const int W = nes_.fbuf.Width();
     const int H = nes_.fbuf.Height();
 
@@ -330,6 +419,8 @@ void Display::render() const
 
 void Display::render_overlay(double elapsed) const
 {
+    TRACE_SCOPE("render_overlay");
+
     glMatrixMode(GL_PROJECTION);
     glPushMatrix();
 
@@ -342,6 +433,10 @@ void Display::render_overlay(double elapsed) const
 
         render_frame_rate(elapsed);
         render_channel_status();
+        if (show_metrics_)
+            render_metrics();
+        if (show_heatmap_)
+            render_heatmap();
         render_status_message();
         render_sprite_info();
 
@@ -381,6 +476,186 @@ void Display::render_frame_rate(double elapsed) const
     draw_text(text, 16, 8);
 }
 
+void Display::render_metrics() const
+{
+    const int STEP_Y = 10;
+    const int x = screen_w - 8 * 24;
+    const int y = 24;
+    char buf[64] = {'\0'};
+    int offset = 0;
+
+    glPushAttrib(GL_CURRENT_BIT);
+    glColor3f(0.5f, 1.0f, 0.5f);
+        sprintf(buf, "%-8s %6s %6s", "ms", "avg", "p99");
+        draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+    glPopAttrib();
+
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        sprintf(buf, "%-8s %6.2f %6.2f", GetMetricName(id),
+                metrics_.GetAverage(id), metrics_.GetP99(id));
+        draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+    }
+
+    sprintf(buf, "%-8s %6.2f", "jitter", metrics_.GetJitter());
+    draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+
+    offset++;
+
+    // CPU usage in emulated cycles
+    if (!DebugHooks::stats) {
+        sprintf(buf, "%-11s %s", "cpu stats", "not built in");
+        draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+    }
+    else {
+        sprintf(buf, "%-11s %6.0f", "nmi at", metrics_.GetAverageNmiCycle());
+        draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+
+        sprintf(buf, "%-11s %6.0f", "nmi handler", metrics_.GetAverageNmiHandlerCycles());
+        draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+
+        sprintf(buf, "%-11s %5.1f%%", "cpu usage", 100. * metrics_.GetCpuUsage());
+        draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+
+        sprintf(buf, "%-11s %2d/%d", "lag frames",
+                metrics_.GetLagFrameCount(), metrics_.GetWindowCount());
+        draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+    }
+
+    offset++;
+
+    // audio queue in samples. 735 samples per frame
+    sprintf(buf, "%-11s %6.0f", "queue avg", metrics_.GetAverageQueuedSamples());
+    draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+
+    sprintf(buf, "%-11s %6d", "queue min", metrics_.GetMinQueuedSamples());
+    draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+
+    sprintf(buf, "%-11s %6d", "underruns", metrics_.GetUnderrunCount());
+    draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+
+    sprintf(buf, "%-11s %6d", "overruns", metrics_.GetOverrunCount());
+    draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+
+    sprintf(buf, "%-11s %6.3f %d", "speed", metrics_.GetSpeedFactor(),
+            metrics_.GetSpeedChangeCount());
+    draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+
+    offset++;
+
+    // frame time histogram over the window
+    std::array<int,FrameMetrics::HISTOGRAM_BINS> hist;
+    metrics_.GetHistogram(hist);
+
+    const int BAR_LEN = 12;
+    const char BAR[] = "############";
+    const int total = std::max(metrics_.GetWindowCount(), 1);
+    const int last = FrameMetrics::HISTOGRAM_BINS - 1;
+
+    for (int bin = 0; bin < FrameMetrics::HISTOGRAM_BINS; bin++) {
+        const int lo = bin * FrameMetrics::HISTOGRAM_BIN_MS;
+        const int len = (hist[bin] * BAR_LEN + total - 1) / total;
+
+        if (bin < last)
+            sprintf(buf, "%2d-%2d %-12.*s %3d", lo,
+                    static_cast<int>(lo + FrameMetrics::HISTOGRAM_BIN_MS),
+                    len, BAR, hist[bin]);
+        else
+            sprintf(buf, "%2d+   %-12.*s %3d", lo, len, BAR, hist[bin]);
+        draw_text(buf, x, y + STEP_Y * offset++, TEXT_OUTLINE);
+    }
+}
+
+void Display::render_heatmap() const
+{
+    const AccessCounter &cpu = heatmap_.GetCpuWindow();
+    const AccessCounter &ppu = heatmap_.GetPpuWindow();
+    const int STEP_Y = 10;
+    const int x = 16;
+    const int y = 24;
+    char buf[64] = {'\0'};
+
+    // reload only when a window completes
+    static uint64_t loaded_count = ~0ull;
+    if (heatmap_.GetCompletedWindowCount() != loaded_count) {
+        LoadHeatmap(cpu_heatmap, cpu);
+        LoadHeatmap(ppu_heatmap, ppu);
+        loaded_count = heatmap_.GetCompletedWindowCount();
+    }
+
+    const struct {
+        const FrameBuffer &fb;
+        const char *label;
+        int y;
+    } maps[] = {
+        {cpu_heatmap, "CPU $0000-$FFFF", y},
+        {ppu_heatmap, "PPU $0000-$3FFF", y + STEP_Y + cpu_heatmap.Height() + 8},
+    };
+
+    glPushAttrib(GL_CURRENT_BIT);
+    glColor3f(1.f, 1.f, 1.f);
+
+    for (const auto &map: maps) {
+        const int W = map.fb.Width();
+        const int H = map.fb.Height();
+        const int Y = map.y + STEP_Y;
+
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, heatmap_id);
+        transfer_texture(map.fb);
+
+        glBegin(GL_QUADS);
+            glTexCoord2f(0, 0); glVertex2f(x,     Y);
+            glTexCoord2f(1, 0); glVertex2f(x + W, Y);
+            glTexCoord2f(1, 1); glVertex2f(x + W, Y + H);
+            glTexCoord2f(0, 1); glVertex2f(x,     Y + H);
+        glEnd();
+        glDisable(GL_TEXTURE_2D);
+
+        draw_text(map.label, x, map.y, TEXT_OUTLINE);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, main_screen);
+    glPopAttrib();
+
+    // hot RAM variables
+    std::array<int,8> hot;
+    hot.fill(-1);
+
+    for (int addr = 0; addr < 0x0800; addr++) {
+        const uint64_t count = cpu.Get(ACCESS_READ, addr) + cpu.Get(ACCESS_WRITE, addr);
+        if (count == 0)
+            continue;
+
+        for (int i = 0; i < static_cast<int>(hot.size()); i++) {
+            const uint64_t hot_count = hot[i] < 0 ? 0 :
+                cpu.Get(ACCESS_READ, hot[i]) + cpu.Get(ACCESS_WRITE, hot[i]);
+
+            if (count > hot_count) {
+                std::copy_backward(hot.begin() + i, hot.end() - 1, hot.end());
+                hot[i] = addr;
+                break;
+            }
+        }
+    }
+
+    const int X = x + cpu_heatmap.Width() + 16;
+    int offset = 0;
+
+    glPushAttrib(GL_CURRENT_BIT);
+    glColor3f(0.5f, 1.0f, 0.5f);
+        sprintf(buf, "%-5s %8s %8s", "RAM", "reads", "writes");
+        draw_text(buf, X, y + STEP_Y * offset++, TEXT_OUTLINE);
+    glPopAttrib();
+
+    for (const auto addr: hot) {
+        if (addr < 0)
+            break;
+        sprintf(buf, "$%04X %8u %8u", addr,
+                cpu.Get(ACCESS_READ, addr), cpu.Get(ACCESS_WRITE, addr));
+        draw_text(buf, X, y + STEP_Y * offset++, TEXT_OUTLINE);
+    }
+}
+
 void Display::render_channel_status() const
 {
     const bool all_channels_on = nes_.GetChannelEnable() == 0x1F;
@@ -440,7 +715,7 @@ void Display::render_status_message() const
         break;
     }
 
-    draw_text(status_message_, x, y);
+    draw_text(status_message_.c_str(), x, y);
 
     glPopAttrib();
 }
@@ -457,56 +732,49 @@ void Display::render_sprite_info() const
 
     const Coord screen = video_to_screen(x, y);
 
+    char buf[32] = {'\0'};
     int offset = 0;
     const int X = screen.x + 4;
     const int Y = screen.y;
 
-    std::string text =
-        std::string("oam index: ") + std::to_string(obj.oam_index);
-    draw_text(text, X, Y + 8 * offset++, TEXT_OUTLINE);
+    sprintf(buf, "oam index: %d", obj.oam_index);
+    draw_text(buf, X, Y + 8 * offset++, TEXT_OUTLINE);
 
-    text = std::string("oam x: ") + std::to_string(obj.x);
-    draw_text(text, X, Y + 8 * offset++, TEXT_OUTLINE);
+    sprintf(buf, "oam x: %d", obj.x);
+    draw_text(buf, X, Y + 8 * offset++, TEXT_OUTLINE);
 
-    text = std::string("oam y: ") + std::to_string(obj.y);
-    draw_text(text, X, Y + 8 * offset++, TEXT_OUTLINE);
+    sprintf(buf, "oam y: %d", obj.y);
+    draw_text(buf, X, Y + 8 * offset++, TEXT_OUTLINE);
 }
 
 int Display::render_cpu_info(int x, int y, int step_y) const
 {
     const CpuStatus stat = nes_.cpu.GetStatus();
-    char buf[16] = {'\0'};
+    char buf[32] = {'\0'};
     int offset = 0;
 
     glPushAttrib(GL_CURRENT_BIT);
     glColor3f(0.5f, 1.0f, 0.5f);
-        std::string text = "CPU";
-        draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+        draw_text("CPU", x, y + step_y * offset++, TEXT_OUTLINE);
     glPopAttrib();
 
-    sprintf(buf, "$%04X", stat.pc);
-    text = std::string("PC: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "PC: $%04X", stat.pc);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "$%02X", stat.a);
-    text = std::string("A: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "A: $%02X", stat.a);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "$%02X", stat.x);
-    text = std::string("X: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "X: $%02X", stat.x);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "$%02X", stat.y);
-    text = std::string("Y: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "Y: $%02X", stat.y);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "$%02X", stat.p);
-    text = std::string("P: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "P: $%02X", stat.p);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "$%02X", stat.s);
-    text = std::string("S: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "S: $%02X", stat.s);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
     return y + step_y * offset;
 }
@@ -514,44 +782,37 @@ int Display::render_cpu_info(int x, int y, int step_y) const
 int Display::render_ppu_info(int x, int y, int step_y) const
 {
     const PpuStatus stat = nes_.ppu.GetStatus();
-    char buf[16] = {'\0'};
+    char buf[32] = {'\0'};
     int offset = 0;
 
     glPushAttrib(GL_CURRENT_BIT);
     glColor3f(0.5f, 1.0f, 0.5f);
-        std::string text = "PPU";
-        draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+        draw_text("PPU", x, y + step_y * offset++, TEXT_OUTLINE);
     glPopAttrib();
 
-    text = std::string("cycle: ") + std::to_string(nes_.ppu.GetCycle());
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "cycle: %d", nes_.ppu.GetCycle());
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    text = std::string("scanlin: ") + std::to_string(nes_.ppu.GetScanline());
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "scanlin: %d", nes_.ppu.GetScanline());
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "$%02X", stat.ctrl);
-    text = std::string("ctrl: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "ctrl: $%02X", stat.ctrl);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "$%02X", stat.mask);
-    text = std::string("mask: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "mask: $%02X", stat.mask);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "$%02X", stat.stat);
-    text = std::string("stat: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "stat: $%02X", stat.stat);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "$%02X", stat.fine_x);
-    text = std::string("fine_x: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "fine_x: $%02X", stat.fine_x);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "$%04X", stat.vram_addr);
-    text = std::string("vram_addr: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "vram_addr: $%04X", stat.vram_addr);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "$%04X", stat.temp_addr);
-    text = std::string("temp_addr: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "temp_addr: $%04X", stat.temp_addr);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
     return y + step_y * offset;
 }
@@ -559,7 +820,7 @@ int Display::render_ppu_info(int x, int y, int step_y) const
 int Display::render_cart_info(int x, int y, int step_y) const
 {
     const Cartridge *cart = nes_.GetCartridge();
-    char buf[16] = {'\0'};
+    char buf[32] = {'\0'};
     int offset = 0;
 
     CartridgeStatus stat;
@@ -567,50 +828,40 @@ int Display::render_cart_info(int x, int y, int step_y) const
 
     glPushAttrib(GL_CURRENT_BIT);
     glColor3f(0.5f, 1.0f, 0.5f);
-        std::string text = "Cartridge";
-        draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+        draw_text("Cartridge", x, y + step_y * offset++, TEXT_OUTLINE);
     glPopAttrib();
 
-    sprintf(buf, "%03d", stat.mapper_id);
-    text = std::string("iNES Mapper: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "iNES Mapper: %03d", stat.mapper_id);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "%luKB", stat.prg_size / 1024);
-    text = std::string("PRG: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "PRG: %luKB", stat.prg_size / 1024);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "%luKB", stat.chr_size / 1024);
-    text = std::string("CHR: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "CHR: %luKB", stat.chr_size / 1024);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "%d", stat.has_battery);
-    text = std::string("Battery Present: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "Battery Present: %d", stat.has_battery);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    sprintf(buf, "%d", stat.mirroring);
-    text = std::string("Mirroring: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "Mirroring: %d", stat.mirroring);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
     offset++;
 
-    sprintf(buf, "%d", stat.prg_bank_count);
-    text = std::string("PRG bank count: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "PRG bank count: %d", stat.prg_bank_count);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    for (int i = 0; i < stat.prg_selected.size(); i++) {
-        sprintf(buf, "[%d]: %d", i, stat.prg_selected[i]);
-        text = std::string("  PRG") + buf;
-        draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    for (int i = 0; i < stat.prg_banks.window_count; i++) {
+        sprintf(buf, "  PRG[%d]: %d", i, stat.prg_banks.selected[i]);
+        draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
     }
 
-    sprintf(buf, "%d", stat.chr_bank_count);
-    text = std::string("CHR bank count: ") + buf;
-    draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    sprintf(buf, "CHR bank count: %d", stat.chr_bank_count);
+    draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
 
-    for (int i = 0; i < stat.chr_selected.size(); i++) {
-        sprintf(buf, "[%d]: %d", i, stat.chr_selected[i]);
-        text = std::string("  CHR") + buf;
-        draw_text(text, x, y + step_y * offset++, TEXT_OUTLINE);
+    for (int i = 0; i < stat.chr_banks.window_count; i++) {
+        sprintf(buf, "  CHR[%d]: %d", i, stat.chr_banks.selected[i]);
+        draw_text(buf, x, y + step_y * offset++, TEXT_OUTLINE);
     }
 
     return y + step_y * offset;
@@ -913,11 +1164,30 @@ void Display::toggle_channel_bits(uint8_t toggle_bits)
     channel_frame_ = frame_;
 }
 
+void Display::toggle_heatmap()
+{
+    show_heatmap_ = !show_heatmap_;
+
+    if (show_heatmap_) {
+        nes_.cpu.SetAccessCounter(&heatmap_.cpu);
+        nes_.ppu.SetAccessCounter(&heatmap_.ppu);
+    }
+    else {
+        nes_.cpu.SetAccessCounter(nullptr);
+        nes_.ppu.SetAccessCounter(nullptr);
+    }
+}
+
 static void transfer_texture(const FrameBuffer &fb)
 {
+    TRACE_SCOPE("transfer_texture");
+    const uint64_t start = GetProfileTicks();
+
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glTexImage2D(GL_TEXTURE_2D, 0, 3, fb.Width(), fb.Height(),
             0, GL_RGB, GL_UNSIGNED_BYTE, fb.GetData());
+
+    texture_ticks += GetProfileTicks() - start;
 }
 
 static void resize(GLFWwindow *window, int width, int height)
@@ -976,7 +1246,7 @@ static Coord video_to_screen(float video_x, float video_y)
     return screen;
 }
 
-static void draw_text(const std::string &text, int x, int y)
+static void draw_text(const char *text, int x, int y)
 {
     glRasterPos2i(x, y + 8);
 
@@ -985,14 +1255,14 @@ static void draw_text(const std::string &text, int x, int y)
     const int offset_x = w - 1;
     const int offset_y = 0;
 
-    for (const auto ch: text) {
-        const uint8_t *bits = GetBitmapChar(ch);
+    for (const char *ch = text; *ch; ch++) {
+        const uint8_t *bits = GetBitmapChar(*ch);
 
         glBitmap(w, h, 0, 0, offset_x, offset_y, bits);
     }
 }
 
-static void draw_text(const std::string &text, int x, int y, TextDecoration deco)
+static void draw_text(const char *text, int x, int y, TextDecoration deco)
 {
     if (deco == TEXT_OUTLINE) {
         glPushAttrib(GL_CURRENT_BIT);
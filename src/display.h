@@ -3,6 +3,8 @@
 
 #include <cstdint>
 #include <string>
+#include "metrics.h"
+#include "heatmap.h"
 
 namespace nes {
 
@@ -20,6 +22,7 @@ public:
     ~Display();
 
     int Open();
+    bool OpenMetricsCsv(const std::string &filename) { return metrics_.OpenCsv(filename); }
 
 private:
     NES &nes_;
@@ -28,6 +31,11 @@ private:
     bool show_guide_ = false;
     bool show_patt_ = false;
     bool show_oam_ = false;
+    bool show_metrics_ = false;
+    bool show_heatmap_ = false;
+
+    FrameMetrics metrics_;
+    MemoryHeatmap heatmap_ {60};
 
     std::string status_message_;
     int message_duration_ = 0;
@@ -40,6 +48,8 @@ private:
     void render() const;
     void render_overlay(double elapsed) const;
     void render_frame_rate(double elapsed) const;
+    void render_metrics() const;
+    void render_heatmap() const;
     void render_channel_status() const;
     void render_status_message() const;
     void render_sprite_info() const;
@@ -57,6 +67,7 @@ private:
     void set_status_message(const std::string &message);
     void set_status_message(const std::string &message, MessageColor color, int duration);
     void toggle_channel_bits(uint8_t toggle_bits);
+    void toggle_heatmap();
 };
 
 } // namespace
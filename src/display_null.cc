@@ -0,0 +1,23 @@
+#include <iostream>
+#include "display.h"
+
+namespace nes {
+
+// Display for headless builds. There is no window to open so the game
+// can only be run with --headless.
+
+Display::Display(NES &nes) : nes_(nes)
+{
+}
+
+Display::~Display()
+{
+}
+
+int Display::Open()
+{
+    std::cerr << "no display in headless build. use --headless" << std::endl;
+    return -1;
+}
+
+} // namespace
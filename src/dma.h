@@ -43,6 +43,16 @@ private:
         SERIALIZE(ar, data, write_count_);
         SERIALIZE_NAMESPACE_END(ar);
     }
+
+    friend void HashState(StateHash &h, const DMA *data)
+    {
+        HASH_STATE(h, data, cycles_);
+        HASH_STATE(h, data, wait_);
+        HASH_STATE(h, data, page_);
+        HASH_STATE(h, data, addr_);
+        HASH_STATE(h, data, data_);
+        HASH_STATE(h, data, write_count_);
+    }
 };
 
 } // namespace
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cstring>
+#include "exec_trace.h"
+#include "disassemble.h"
+#include "cpu.h"
+#include "ppu.h"
+
+namespace nes {
+
+static_assert(sizeof(ExecRecord) == 32, "ExecRecord is not 32 bytes");
+
+static const char TRACE_MAGIC[8] = {'F', 'C', '4', '0', 'E', 'X', 'E', 'C'};
+// chunks waiting for the writer before Add() blocks. 8MB
+static const size_t MAX_CHUNK_COUNT = 64;
+
+void CaptureExecRecord(const CPU &cpu, const PPU &ppu, ExecRecord &rec)
+{
+    const CpuStatus stat = cpu.GetStatus();
+    const Code code = DisassembleLine(cpu, stat.pc);
+    const MemoryRef ref = PeekMemoryRef(code, cpu);
+
+    rec.cycle = cpu.GetTotalCycles();
+    rec.pc = stat.pc;
+    rec.scanline = ppu.GetScanline();
+    rec.ppu_cycle = ppu.GetCycle();
+    rec.pointer = ref.pointer;
+    rec.code[0] = code.opcode;
+    rec.code[1] = code.lo;
+    rec.code[2] = code.hi;
+    rec.a = stat.a;
+    rec.x = stat.x;
+    rec.y = stat.y;
+    rec.p = stat.p;
+    rec.s = stat.s;
+    rec.value = ref.value;
+}
+
+std::string FormatExecRecord(const ExecRecord &rec)
+{
+    Code code;
+    code.instruction = Decode(rec.code[0]);
+    code.address = rec.pc;
+    code.opcode = rec.code[0];
+    code.lo = rec.code[1];
+    code.hi = rec.code[2];
+    code.word = (code.hi << 8) | code.lo;
+
+    MemoryRef ref;
+    ref.pointer = rec.pointer;
+    ref.value = rec.value;
+
+    const std::string code_str = GetCodeString(code);
+    const std::string mem_str = GetMemoryString(code, rec.x, rec.y, ref);
+    const int padding = 48 - code_str.length() - mem_str.length();
+
+    char buf[128] = {'\0'};
+    snprintf(buf, sizeof(buf), "%*s"
+            "A:%02X X:%02X Y:%02X P:%02X SP:%02X PPU:%3d,%3d CYC:%llu",
+            padding, " ",
+            rec.a, rec.x, rec.y, rec.p, rec.s,
+            rec.scanline, rec.ppu_cycle,
+            static_cast<unsigned long long>(rec.cycle));
+
+    return code_str + mem_str + buf;
+}
+
+ExecTrace::ExecTrace()
+{
+}
+
+ExecTrace::~ExecTrace()
+{
+    Close();
+}
+
+void ExecTrace::OpenRing(size_t record_count)
+{
+    Close();
+
+    const size_t N = std::max<size_t>((record_count + CHUNK_SIZE - 1) / CHUNK_SIZE, 2);
+    ring_.clear();
+    for (size_t i = 0; i < N; i++)
+        ring_.emplace_back(new Chunk(CHUNK_SIZE));
+
+    ring_index_ = 0;
+    chunk_ = ring_[0].get();
+    fill_ = 0;
+    full_chunk_count_ = 0;
+}
+
+bool ExecTrace::OpenFile(const std::string &filename)
+{
+    Close();
+    ring_.clear();
+
+    fp_ = fopen(filename.c_str(), "wb");
+    if (!fp_)
+        return false;
+
+    const uint32_t header[] = {sizeof(ExecRecord), 0};
+    fwrite(TRACE_MAGIC, sizeof(TRACE_MAGIC), 1, fp_);
+    fwrite(header, sizeof(header), 1, fp_);
+
+    pool_.emplace_back(new Chunk(CHUNK_SIZE));
+    chunk_ = pool_.back().get();
+    fill_ = 0;
+    full_chunk_count_ = 0;
+    closing_ = false;
+
+    writer_ = std::thread(&ExecTrace::write_chunks, this);
+
+    return true;
+}
+
+void ExecTrace::Close()
+{
+    if (!fp_)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    cond_.notify_all();
+    writer_.join();
+
+    // the writer is done. the rest is in the current chunk
+    fwrite(chunk_->data(), sizeof(ExecRecord), fill_, fp_);
+    fclose(fp_);
+    fp_ = nullptr;
+
+    chunk_ = nullptr;
+    fill_ = 0;
+    full_.clear();
+    free_.clear();
+    pool_.clear();
+}
+
+bool ExecTrace::SaveRing(const std::string &filename) const
+{
+    if (ring_.empty())
+        return false;
+
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp)
+        return false;
+
+    const uint32_t header[] = {sizeof(ExecRecord), 0};
+    fwrite(TRACE_MAGIC, sizeof(TRACE_MAGIC), 1, fp);
+    fwrite(header, sizeof(header), 1, fp);
+
+    // full chunks from the oldest, then the current one
+    const size_t N = ring_.size();
+    const bool wrapped = full_chunk_count_ >= N;
+    const size_t first = wrapped ? ring_index_ + 1 : 0;
+    const size_t count = wrapped ? N - 1 : ring_index_;
+
+    for (size_t i = 0; i < count; i++) {
+        const Chunk &chunk = *ring_[(first + i) % N];
+        fwrite(chunk.data(), sizeof(ExecRecord), CHUNK_SIZE, fp);
+    }
+    fwrite(chunk_->data(), sizeof(ExecRecord), fill_, fp);
+
+    const bool ok = !ferror(fp);
+    fclose(fp);
+
+    return ok;
+}
+
+uint64_t ExecTrace::GetRecordCount() const
+{
+    return full_chunk_count_ * CHUNK_SIZE + fill_;
+}
+
+void ExecTrace::next_chunk()
+{
+    full_chunk_count_++;
+    fill_ = 0;
+
+    if (!fp_) {
+        ring_index_ = (ring_index_ + 1) % ring_.size();
+        chunk_ = ring_[ring_index_].get();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    full_.push_back(chunk_);
+    cond_.notify_all();
+
+    if (free_.empty() && pool_.size() < MAX_CHUNK_COUNT) {
+        pool_.emplace_back(new Chunk(CHUNK_SIZE));
+        free_.push_back(pool_.back().get());
+    }
+
+    // waits for the writer when all chunks are in flight
+    cond_.wait(lock, [this] { return !free_.empty(); });
+    chunk_ = free_.back();
+    free_.pop_back();
+}
+
+void ExecTrace::write_chunks()
+{
+    for (;;) {
+        Chunk *chunk = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this] { return !full_.empty() || closing_; });
+
+            if (full_.empty())
+                break;
+
+            chunk = full_.front();
+            full_.pop_front();
+        }
+
+        fwrite(chunk->data(), sizeof(ExecRecord), CHUNK_SIZE, fp_);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(chunk);
+        }
+        cond_.notify_all();
+    }
+}
+
+bool PrintExecTrace(const std::string &filename)
+{
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (!fp)
+        return false;
+
+    char magic[8] = {'\0'};
+    uint32_t header[2] = {0};
+
+    if (fread(magic, sizeof(magic), 1, fp) != 1 ||
+        fread(header, sizeof(header), 1, fp) != 1 ||
+        memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 ||
+        header[0] != sizeof(ExecRecord)) {
+        fclose(fp);
+        return false;
+    }
+
+    std::vector<ExecRecord> records(ExecTrace::CHUNK_SIZE);
+
+    for (;;) {
+        const size_t N = fread(records.data(), sizeof(ExecRecord), records.size(), fp);
+
+        for (size_t i = 0; i < N; i++)
+            printf("%s\n", FormatExecRecord(records[i]).c_str());
+
+        if (N < records.size())
+            break;
+    }
+
+    fclose(fp);
+    return true;
+}
+
+} // namespace
@@ -0,0 +1,100 @@
+#ifndef EXEC_TRACE_H
+#define EXEC_TRACE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nes {
+
+class CPU;
+class PPU;
+
+// CPU state before an instruction runs. pointer and value are what the
+// nestest log shows after the operand, e.g. "@ 80 = 0200 = 5A"
+struct ExecRecord {
+    uint64_t cycle = 0;
+    uint16_t pc = 0;
+    uint16_t scanline = 0;
+    uint16_t ppu_cycle = 0;
+    uint16_t pointer = 0;
+    uint8_t code[3] = {0};
+    uint8_t a = 0, x = 0, y = 0, p = 0, s = 0;
+    uint8_t value = 0;
+    uint8_t reserved[7] = {0};
+};
+
+void CaptureExecRecord(const CPU &cpu, const PPU &ppu, ExecRecord &rec);
+// one line in the nestest log format
+std::string FormatExecRecord(const ExecRecord &rec);
+
+// Execution trace of ExecRecords. Records are kept in the latest chunks of
+// a ring in memory or streamed to a file by a background writer thread.
+//
+// File is the header below followed by the records in host byte order:
+//   char[8]  "FC40EXEC"
+//   uint32   record size
+//   uint32   reserved
+class ExecTrace {
+public:
+    ExecTrace();
+    ~ExecTrace();
+
+    // keeps about the latest record_count records
+    void OpenRing(size_t record_count);
+    // streams every record to the file
+    bool OpenFile(const std::string &filename);
+    // writes the records left and stops the writer
+    void Close();
+    // writes the ring to the file, oldest record first
+    bool SaveRing(const std::string &filename) const;
+
+    void Add(const ExecRecord &rec)
+    {
+        (*chunk_)[fill_++] = rec;
+
+        if (fill_ == CHUNK_SIZE)
+            next_chunk();
+    }
+
+    uint64_t GetRecordCount() const;
+
+    static constexpr int CHUNK_SIZE = 4096;
+
+private:
+    using Chunk = std::vector<ExecRecord>;
+
+    Chunk *chunk_ = nullptr;
+    int fill_ = 0;
+    uint64_t full_chunk_count_ = 0;
+
+    // ring
+    std::vector<std::unique_ptr<Chunk>> ring_;
+    size_t ring_index_ = 0;
+
+    // file
+    FILE *fp_ = nullptr;
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<Chunk*> full_;
+    std::vector<Chunk*> free_;
+    std::vector<std::unique_ptr<Chunk>> pool_;
+    bool closing_ = false;
+
+    void next_chunk();
+    void write_chunks();
+};
+
+// prints a trace file in the nestest log format
+bool PrintExecTrace(const std::string &filename);
+
+} // namespace
+
+#endif // _H
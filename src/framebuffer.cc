@@ -1,4 +1,5 @@
 #include "framebuffer.h"
+#include "hash.h"
 
 namespace nes {
 
@@ -23,4 +24,9 @@ void FrameBuffer::SetColor(int x, int y, Color col)
     data_[index + 2] = col.b;
 }
 
+uint64_t FrameBuffer::GetHash() const
+{
+    return HashBytes(data_.data(), data_.size());
+}
+
 } // namespace
@@ -21,6 +21,8 @@ public:
     int Width() const { return width_; }
     int Height() const { return height_; }
     const uint8_t *GetData() const { return &data_[0]; }
+    // hash of the pixels. same image, same hash across runs and hosts
+    uint64_t GetHash() const;
 
 private:
     int width_, height_;
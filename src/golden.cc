@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "golden.h"
+
+namespace nes {
+
+bool LoadGolden(const std::string &filename, std::vector<FrameHash> &hashes)
+{
+    std::ifstream ifs(filename);
+    if (!ifs)
+        return false;
+
+    hashes.clear();
+
+    std::string line;
+    while (std::getline(ifs, line)) {
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream iss(line);
+        FrameHash hash;
+
+        if (!(iss >> hash.frame))
+            continue;
+        if (!(iss >> std::hex >> hash.video))
+            return false;
+        if (iss >> hash.audio)
+            hash.has_audio = true;
+
+        hashes.push_back(hash);
+    }
+
+    // in frame order. the first line of a frame wins
+    std::stable_sort(hashes.begin(), hashes.end(),
+            [](const FrameHash &a, const FrameHash &b) { return a.frame < b.frame; });
+    hashes.erase(std::unique(hashes.begin(), hashes.end(),
+            [](const FrameHash &a, const FrameHash &b) { return a.frame == b.frame; }),
+            hashes.end());
+
+    return true;
+}
+
+bool SaveGolden(const std::string &filename, const std::vector<FrameHash> &hashes)
+{
+    FILE *fp = fopen(filename.c_str(), "w");
+    if (!fp)
+        return false;
+
+    fprintf(fp, "# frame video [audio]\n");
+
+    for (const auto &hash: hashes) {
+        fprintf(fp, "%llu %016llx",
+                static_cast<unsigned long long>(hash.frame),
+                static_cast<unsigned long long>(hash.video));
+        if (hash.has_audio)
+            fprintf(fp, " %016llx", static_cast<unsigned long long>(hash.audio));
+        fprintf(fp, "\n");
+    }
+
+    const bool ok = !ferror(fp);
+    fclose(fp);
+
+    return ok;
+}
+
+int CompareGolden(const std::vector<FrameHash> &expected,
+        const std::vector<FrameHash> &actual)
+{
+    int mismatch_count = 0;
+
+    for (const auto &exp: expected) {
+        const auto it = std::find_if(actual.begin(), actual.end(),
+                [&exp](const FrameHash &act) { return act.frame == exp.frame; });
+
+        if (it == actual.end()) {
+            printf("frame %llu: not run\n", static_cast<unsigned long long>(exp.frame));
+            mismatch_count++;
+            continue;
+        }
+
+        const FrameHash &act = *it;
+        bool match = true;
+
+        if (act.video != exp.video) {
+            printf("frame %llu: video %016llx, expected %016llx\n",
+                    static_cast<unsigned long long>(exp.frame),
+                    static_cast<unsigned long long>(act.video),
+                    static_cast<unsigned long long>(exp.video));
+            match = false;
+        }
+        if (act.has_audio && exp.has_audio && act.audio != exp.audio) {
+            printf("frame %llu: audio %016llx, expected %016llx\n",
+                    static_cast<unsigned long long>(exp.frame),
+                    static_cast<unsigned long long>(act.audio),
+                    static_cast<unsigned long long>(exp.audio));
+            match = false;
+        }
+
+        if (!match)
+            mismatch_count++;
+    }
+
+    return mismatch_count;
+}
+
+} // namespace
@@ -0,0 +1,32 @@
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nes {
+
+// Hashes of the frame buffer and, optionally, of all audio samples so far
+// at the end of a frame. frame is the number of frames run, from 1.
+struct FrameHash {
+    uint64_t frame = 0;
+    uint64_t video = 0;
+    uint64_t audio = 0;
+    bool has_audio = false;
+};
+
+// Golden file is text, one frame per line, '#' to the end of line is comment
+//   <frame> <video hash> [<audio hash>]
+// hashes are 16 hex digits. loaded in frame order, one per frame
+bool LoadGolden(const std::string &filename, std::vector<FrameHash> &hashes);
+bool SaveGolden(const std::string &filename, const std::vector<FrameHash> &hashes);
+
+// prints a line per mismatch and returns the number of frames that do not
+// match. frames are looked up by number. audio is compared only when both have it
+int CompareGolden(const std::vector<FrameHash> &expected,
+        const std::vector<FrameHash> &actual);
+
+} // namespace
+
+#endif // _H
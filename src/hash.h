@@ -0,0 +1,78 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace nes {
+
+// 64-bit FNV-1a. pass the previous hash to continue over more data
+constexpr uint64_t HASH_INIT = 0xCBF29CE484222325;
+
+inline uint64_t HashBytes(const void *data, size_t size, uint64_t hash = HASH_INIT)
+{
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3;
+    }
+
+    return hash;
+}
+
+// Hash of emulator state for determinism checks, cheap enough for every
+// frame. Blocks are read 8 bytes at a time into 4 independent lanes.
+// Values differ from HashBytes() and may change between versions
+class StateHash {
+public:
+    template<typename T>
+    void Add(T value)
+    {
+        uint64_t bits = 0;
+        memcpy(&bits, &value, sizeof(value));
+        hash_ = mix(hash_ ^ bits);
+    }
+
+    void AddBlock(const void *data, size_t size)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t*>(data);
+        uint64_t lane[4] = {hash_, hash_ + 1, hash_ + 2, hash_ + 3};
+        size_t i = 0;
+
+        for (; i + 32 <= size; i += 32) {
+            for (int j = 0; j < 4; j++) {
+                uint64_t word;
+                memcpy(&word, bytes + i + 8 * j, 8);
+                lane[j] = mix(lane[j] ^ word);
+            }
+        }
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, bytes + i, 8);
+            lane[0] = mix(lane[0] ^ word);
+        }
+        for (; i < size; i++)
+            lane[1] = mix(lane[1] ^ bytes[i]);
+
+        hash_ = mix(lane[0] ^ size);
+        for (int j = 1; j < 4; j++)
+            hash_ = mix(hash_ ^ lane[j]);
+    }
+
+    uint64_t Get() const { return hash_; }
+
+private:
+    uint64_t hash_ = HASH_INIT;
+
+    static uint64_t mix(uint64_t x)
+    {
+        x *= 0x9E3779B97F4A7C15;
+        return x ^ (x >> 29);
+    }
+};
+
+} // namespace
+
+#endif // _H
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include "heatmap.h"
+
+namespace nes {
+
+static const char DUMP_MAGIC[8] = {'F', 'C', '4', '0', 'H', 'E', 'A', 'T'};
+
+AccessCounter::AccessCounter() : counts_(ACCESS_TYPE_COUNT * ADDR_COUNT, 0)
+{
+}
+
+AccessCounter::~AccessCounter()
+{
+}
+
+uint32_t AccessCounter::GetMax(int type) const
+{
+    const auto begin = counts_.begin() + type * ADDR_COUNT;
+    return *std::max_element(begin, begin + ADDR_COUNT);
+}
+
+void AccessCounter::Clear()
+{
+    std::fill(counts_.begin(), counts_.end(), 0);
+}
+
+void AccessCounter::Swap(AccessCounter &other)
+{
+    counts_.swap(other.counts_);
+}
+
+static bool write_window(FILE *fp, uint64_t first_frame, int frame_count,
+        const AccessCounter &cpu, const AccessCounter &ppu)
+{
+    const uint32_t header[] = {
+        static_cast<uint32_t>(first_frame),
+        static_cast<uint32_t>(frame_count)
+    };
+    const size_t N = ACCESS_TYPE_COUNT * AccessCounter::ADDR_COUNT;
+
+    if (fwrite(DUMP_MAGIC, sizeof(DUMP_MAGIC), 1, fp) != 1)
+        return false;
+    if (fwrite(header, sizeof(header), 1, fp) != 1)
+        return false;
+    if (fwrite(cpu.GetData(), sizeof(uint32_t), N, fp) != N)
+        return false;
+    if (fwrite(ppu.GetData(), sizeof(uint32_t), N, fp) != N)
+        return false;
+
+    return true;
+}
+
+MemoryHeatmap::MemoryHeatmap(int window_frames)
+    : window_frames_(std::max(window_frames, 1))
+{
+}
+
+MemoryHeatmap::~MemoryHeatmap()
+{
+    if (dump_)
+        fclose(dump_);
+}
+
+bool MemoryHeatmap::OpenDump(const std::string &filename)
+{
+    if (dump_)
+        fclose(dump_);
+
+    dump_ = fopen(filename.c_str(), "wb");
+    return dump_ != nullptr;
+}
+
+bool MemoryHeatmap::SaveWindow(const std::string &filename) const
+{
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp)
+        return false;
+
+    const bool ok = write_window(fp, last_start_, last_frames_, last_cpu_, last_ppu_);
+    fclose(fp);
+
+    return ok;
+}
+
+void MemoryHeatmap::EndFrame()
+{
+    frames_++;
+
+    if (frames_ == window_frames_)
+        complete_window();
+}
+
+void MemoryHeatmap::Flush()
+{
+    if (frames_ > 0)
+        complete_window();
+}
+
+void MemoryHeatmap::complete_window()
+{
+    last_cpu_.Swap(cpu);
+    last_ppu_.Swap(ppu);
+    cpu.Clear();
+    ppu.Clear();
+
+    last_start_ = window_start_;
+    last_frames_ = frames_;
+    window_start_ += frames_;
+    frames_ = 0;
+    completed_count_++;
+
+    if (dump_)
+        write_window(dump_, last_start_, last_frames_, last_cpu_, last_ppu_);
+}
+
+} // namespace
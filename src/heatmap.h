@@ -0,0 +1,87 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace nes {
+
+enum AccessType {
+    ACCESS_READ = 0,
+    ACCESS_WRITE,
+    ACCESS_EXECUTE,
+    ACCESS_TYPE_COUNT
+};
+
+// Read, write and execute counts per address of a 16 bit bus
+class AccessCounter {
+public:
+    AccessCounter();
+    ~AccessCounter();
+
+    void Count(int type, uint16_t addr) { counts_[type * ADDR_COUNT + addr]++; }
+    uint32_t Get(int type, uint16_t addr) const { return counts_[type * ADDR_COUNT + addr]; }
+    uint32_t GetMax(int type) const;
+    // [read, write, execute][address]
+    const uint32_t *GetData() const { return &counts_[0]; }
+    void Clear();
+    void Swap(AccessCounter &other);
+
+    static constexpr int ADDR_COUNT = 0x10000;
+
+private:
+    std::vector<uint32_t> counts_;
+};
+
+// Counts on the CPU and PPU buses over windows of frames. CPU reads
+// include instruction fetches and mirrored PPU registers are also counted
+// at $2000-$2007.
+//
+// Dump file is a sequence of windows in host byte order:
+//   char[8]  "FC40HEAT"
+//   uint32   first frame, frame count of the window
+//   uint32   cpu counts [read, write, execute][0x10000]
+//   uint32   ppu counts [read, write, execute][0x10000]
+class MemoryHeatmap {
+public:
+    MemoryHeatmap(int window_frames);
+    ~MemoryHeatmap();
+
+    // counted now. CPU::SetAccessCounter() and PPU::SetAccessCounter()
+    AccessCounter cpu;
+    AccessCounter ppu;
+
+    // the last complete window
+    const AccessCounter &GetCpuWindow() const { return last_cpu_; }
+    const AccessCounter &GetPpuWindow() const { return last_ppu_; }
+    int GetWindowFrames() const { return window_frames_; }
+    uint64_t GetCompletedWindowCount() const { return completed_count_; }
+
+    // appends every complete window to the file
+    bool OpenDump(const std::string &filename);
+    // writes the last complete window to a new file
+    bool SaveWindow(const std::string &filename) const;
+
+    void EndFrame();
+    // completes the window with the frames counted so far
+    void Flush();
+
+private:
+    AccessCounter last_cpu_;
+    AccessCounter last_ppu_;
+    int window_frames_ = 60;
+    int frames_ = 0;
+    uint64_t window_start_ = 0;
+    uint64_t last_start_ = 0;
+    int last_frames_ = 0;
+    uint64_t completed_count_ = 0;
+    FILE *dump_ = nullptr;
+
+    void complete_window();
+};
+
+} // namespace
+
+#endif // _H
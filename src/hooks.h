@@ -0,0 +1,36 @@
+#ifndef HOOKS_H
+#define HOOKS_H
+
+// Debugger hooks in the emulation loop, selected at compile time.
+//
+// Build with HOOKS=0 (make headless HOOKS=0) for a production build with
+// every hook compiled out. The checks below are constants and the code
+// behind them is removed. Add new hooks (e.g. watchpoints) here.
+#ifndef NES_HOOKS
+#define NES_HOOKS 1
+#endif
+
+namespace nes {
+
+template<bool Enabled>
+struct HookPolicy {
+    static constexpr bool enabled = Enabled;
+    // instruction log and execution trace. NES::need_log()
+    static constexpr bool log = Enabled;
+    // step to next instruction, scanline or frame. NES::handle_break_condition()
+    static constexpr bool step = Enabled;
+    // scroll per scanline for the grid overlay. PPU::GetScroll()
+    static constexpr bool scroll = Enabled;
+    // bus accesses for the memory heatmap. SetAccessCounter()
+    static constexpr bool access = Enabled;
+    // input to photon latency. SetLatencyProbe()
+    static constexpr bool latency = Enabled;
+    // lag frame, NMI handler and spin loop stats. CPU::GetFrameStats()
+    static constexpr bool stats = Enabled;
+};
+
+using DebugHooks = HookPolicy<NES_HOOKS != 0>;
+
+} // namespace
+
+#endif // _H
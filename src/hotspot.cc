@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cstdio>
+#include "hotspot.h"
+#include "cartridge.h"
+#include "cpu.h"
+#include "instruction.h"
+
+namespace nes {
+
+enum {
+    OPCODE_BRK = 0x00,
+    OPCODE_JSR = 0x20,
+    OPCODE_RTI = 0x40,
+    OPCODE_RTS = 0x60,
+};
+
+// cycles CPU::Run() adds when an interrupt is taken after the instruction
+static const int INTERRUPT_CYCLES = 7;
+
+HotSpotProfiler::HotSpotProfiler()
+{
+}
+
+HotSpotProfiler::~HotSpotProfiler()
+{
+}
+
+void HotSpotProfiler::Attach(const Cartridge *cart)
+{
+    cart_ = cart;
+
+    const size_t N = 0x8000 + (cart_ ? cart_->GetPrgSize() : 0);
+    cycles_.resize(N);
+    self_cycles_.resize(N);
+    total_cycles_.resize(N);
+    calls_.resize(N);
+    addrs_.resize(N);
+    banks_.resize(N);
+
+    Clear();
+}
+
+void HotSpotProfiler::Clear()
+{
+    std::fill(cycles_.begin(), cycles_.end(), 0);
+    std::fill(self_cycles_.begin(), self_cycles_.end(), 0);
+    std::fill(total_cycles_.begin(), total_cycles_.end(), 0);
+    std::fill(calls_.begin(), calls_.end(), 0);
+    std::fill(addrs_.begin(), addrs_.end(), 0);
+    std::fill(banks_.begin(), banks_.end(), -1);
+
+    depth_ = 0;
+    overflow_ = 0;
+    cycle_count_ = 0;
+    root_cycles_ = 0;
+}
+
+void HotSpotProfiler::Fetch(const CPU &cpu)
+{
+    const uint16_t pc = cpu.GetPC();
+
+    fetched_key_ = get_key(pc);
+    fetched_code_ = cpu.PeekData(pc);
+    fetched_base_cycles_ = Decode(fetched_code_).cycles;
+
+    if (fetched_code_ == OPCODE_JSR)
+        jsr_target_ = cpu.PeekData(pc + 1) | (cpu.PeekData(pc + 2) << 8);
+}
+
+void HotSpotProfiler::Retire(const CPU &cpu, int cpu_cycles)
+{
+    // BRK is counted as an interrupt by its opcode
+    const bool interrupted = fetched_code_ != OPCODE_BRK &&
+        cpu_cycles >= fetched_base_cycles_ + INTERRUPT_CYCLES;
+    const int inst_cycles = interrupted ? cpu_cycles - INTERRUPT_CYCLES : cpu_cycles;
+
+    cycle_count_ += inst_cycles;
+    cycles_[fetched_key_] += inst_cycles;
+    if (depth_ > 0)
+        self_cycles_[stack_[depth_ - 1].key] += inst_cycles;
+    else
+        root_cycles_ += inst_cycles;
+
+    switch (fetched_code_) {
+    case OPCODE_JSR:
+        enter(get_key(jsr_target_));
+        break;
+
+    case OPCODE_BRK:
+        enter(get_key(cpu.GetPC()));
+        break;
+
+    case OPCODE_RTS:
+    case OPCODE_RTI:
+        leave();
+        break;
+
+    default:
+        break;
+    }
+
+    if (interrupted) {
+        // the handler runs next. charge the interrupt sequence to it
+        const uint32_t key = get_key(cpu.GetPC());
+        enter(key);
+
+        cycle_count_ += INTERRUPT_CYCLES;
+        cycles_[key] += INTERRUPT_CYCLES;
+        self_cycles_[key] += INTERRUPT_CYCLES;
+    }
+}
+
+uint32_t HotSpotProfiler::get_key(uint16_t addr)
+{
+    uint32_t key = addr;
+    int bank = -1;
+
+    if (addr >= 0x8000 && cart_) {
+        cart_->GetPrgBankInfo(bank_info_);
+
+        const int window_size = 0x8000 / std::max(bank_info_.window_count, 1);
+        const int window = (addr - 0x8000) / window_size;
+        const size_t offset = bank_info_.selected[window] * window_size + addr % window_size;
+
+        bank = bank_info_.selected[window];
+        key = 0x8000 + offset % cart_->GetPrgSize();
+    }
+
+    addrs_[key] = addr;
+    banks_[key] = bank;
+
+    return key;
+}
+
+void HotSpotProfiler::enter(uint32_t key)
+{
+    calls_[key]++;
+
+    if (depth_ == static_cast<int>(stack_.size())) {
+        overflow_++;
+        return;
+    }
+
+    stack_[depth_].key = key;
+    stack_[depth_].entry_cycle = cycle_count_;
+    depth_++;
+}
+
+void HotSpotProfiler::leave()
+{
+    // returns without a call, which games do for jump tables, are ignored
+    if (overflow_ > 0) {
+        overflow_--;
+        return;
+    }
+    if (depth_ == 0)
+        return;
+
+    depth_--;
+    const CallFrame &frame = stack_[depth_];
+
+    // recursive calls are counted at the outermost one
+    for (int i = 0; i < depth_; i++) {
+        if (stack_[i].key == frame.key)
+            return;
+    }
+
+    total_cycles_[frame.key] += cycle_count_ - frame.entry_cycle;
+}
+
+void HotSpotProfiler::print_address(uint32_t key) const
+{
+    if (banks_[key] < 0)
+        printf("  -- $%04X", addrs_[key]);
+    else
+        printf("  %02X $%04X", banks_[key], addrs_[key]);
+}
+
+void HotSpotProfiler::PrintReport(int top_count) const
+{
+    const double total = std::max<double>(cycle_count_, 1);
+    std::vector<uint32_t> keys;
+
+    // routines
+    for (uint32_t key = 0; key < calls_.size(); key++) {
+        if (calls_[key] > 0)
+            keys.push_back(key);
+    }
+
+    const int routine_count = std::min<int>(top_count, keys.size());
+    std::partial_sort(keys.begin(), keys.begin() + routine_count, keys.end(),
+            [this](uint32_t a, uint32_t b) { return self_cycles_[a] > self_cycles_[b]; });
+
+    printf("Routines by self cycles (%llu cycles)\n",
+            static_cast<unsigned long long>(cycle_count_));
+    printf("%4s %5s %10s %12s %7s %12s %7s\n",
+            "bank", "addr", "calls", "self", "self%", "total", "total%");
+
+    for (int i = 0; i < routine_count; i++) {
+        const uint32_t key = keys[i];
+        print_address(key);
+        printf(" %10u %12llu %6.2f%% %12llu %6.2f%%\n",
+                calls_[key],
+                static_cast<unsigned long long>(self_cycles_[key]),
+                100. * self_cycles_[key] / total,
+                static_cast<unsigned long long>(total_cycles_[key]),
+                100. * total_cycles_[key] / total);
+    }
+    printf("%10s %10s %12llu %6.2f%%\n", "(no call)", "",
+            static_cast<unsigned long long>(root_cycles_), 100. * root_cycles_ / total);
+
+    // instructions
+    keys.clear();
+    for (uint32_t key = 0; key < cycles_.size(); key++) {
+        if (cycles_[key] > 0)
+            keys.push_back(key);
+    }
+
+    const int inst_count = std::min<int>(top_count, keys.size());
+    std::partial_sort(keys.begin(), keys.begin() + inst_count, keys.end(),
+            [this](uint32_t a, uint32_t b) { return cycles_[a] > cycles_[b]; });
+
+    printf("\n");
+    printf("Instructions by cycles\n");
+    printf("%4s %5s %12s %7s\n", "bank", "addr", "cycles", "%");
+
+    for (int i = 0; i < inst_count; i++) {
+        const uint32_t key = keys[i];
+        print_address(key);
+        printf(" %12llu %6.2f%%\n",
+                static_cast<unsigned long long>(cycles_[key]),
+                100. * cycles_[key] / total);
+    }
+}
+
+} // namespace
@@ -0,0 +1,69 @@
+#ifndef HOTSPOT_H
+#define HOTSPOT_H
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include "bank_map.h"
+
+namespace nes {
+
+class CPU;
+class Cartridge;
+
+// Emulated CPU cycles per (PRG bank, PC) measured by
+// NES::UpdateFrame(HotSpotProfiler &). Counters are flat arrays indexed by
+// the CPU address below $8000 and by the PRG ROM offset above it.
+// Routines are JSR targets and interrupt handlers.
+class HotSpotProfiler {
+public:
+    HotSpotProfiler();
+    ~HotSpotProfiler();
+
+    void Attach(const Cartridge *cart);
+    void Clear();
+
+    // called before and after each CPU::Run()
+    void Fetch(const CPU &cpu);
+    void Retire(const CPU &cpu, int cpu_cycles);
+
+    // top routines by self cycles and top instructions by cycles
+    void PrintReport(int top_count) const;
+
+private:
+    struct CallFrame {
+        uint32_t key;
+        uint64_t entry_cycle;
+    };
+
+    const Cartridge *cart_ = nullptr;
+    BankInfo bank_info_;
+
+    // per key
+    std::vector<uint64_t> cycles_;
+    std::vector<uint64_t> self_cycles_;
+    std::vector<uint64_t> total_cycles_;
+    std::vector<uint32_t> calls_;
+    std::vector<uint16_t> addrs_;
+    std::vector<int16_t> banks_;
+
+    std::array<CallFrame,256> stack_;
+    int depth_ = 0;
+    int overflow_ = 0;
+
+    uint64_t cycle_count_ = 0;
+    uint64_t root_cycles_ = 0;
+    uint32_t fetched_key_ = 0;
+    uint8_t fetched_code_ = 0;
+    uint8_t fetched_base_cycles_ = 0;
+    uint16_t jsr_target_ = 0;
+
+    uint32_t get_key(uint16_t addr);
+    void enter(uint32_t key);
+    void leave();
+    void print_address(uint32_t key) const;
+};
+
+} // namespace
+
+#endif // _H
@@ -0,0 +1,308 @@
+#include <cstring>
+#include "jit.h"
+
+#if NES_JIT_X64
+#include <sys/mman.h>
+#endif
+
+namespace nes {
+
+CodeBuffer::CodeBuffer(size_t size)
+{
+#if NES_JIT_X64
+    void *mem = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem != MAP_FAILED) {
+        mem_ = static_cast<uint8_t*>(mem);
+        size_ = size;
+    }
+#else
+    (void) size;
+#endif
+}
+
+CodeBuffer::~CodeBuffer()
+{
+#if NES_JIT_X64
+    if (mem_)
+        munmap(mem_, size_);
+#endif
+}
+
+bool CodeBuffer::IsSupported()
+{
+    return NES_JIT_X64;
+}
+
+bool CodeBuffer::IsOpen() const
+{
+    return mem_ != nullptr;
+}
+
+const void *CodeBuffer::Add(const std::vector<uint8_t> &code)
+{
+#if NES_JIT_X64
+    // code starts at 16 bytes like compiled functions
+    const size_t start = (used_ + 15) & ~static_cast<size_t>(15);
+    if (!mem_ || start + code.size() > size_)
+        return nullptr;
+
+    if (mprotect(mem_, size_, PROT_READ | PROT_WRITE) != 0)
+        return nullptr;
+    std::memcpy(mem_ + start, code.data(), code.size());
+    if (mprotect(mem_, size_, PROT_READ | PROT_EXEC) != 0)
+        return nullptr;
+
+    used_ = start + code.size();
+    return mem_ + start;
+#else
+    (void) code;
+    return nullptr;
+#endif
+}
+
+void CodeBuffer::Clear()
+{
+    used_ = 0;
+}
+
+X64Emitter::X64Emitter()
+{
+    // a decoded block fits
+    code_.reserve(4096);
+}
+
+void X64Emitter::Clear()
+{
+    code_.clear();
+}
+
+const std::vector<uint8_t> &X64Emitter::GetCode() const
+{
+    return code_;
+}
+
+size_t X64Emitter::GetSize() const
+{
+    return code_.size();
+}
+
+void X64Emitter::emit(uint8_t byte)
+{
+    code_.push_back(byte);
+}
+
+void X64Emitter::emit32(uint32_t val)
+{
+    for (int i = 0; i < 4; i++)
+        emit(val >> (i * 8));
+}
+
+void X64Emitter::emit_mem(int reg, int32_t disp, bool indexed)
+{
+    // mod 10: disp32. rm 100 needs a SIB byte for the index
+    if (indexed) {
+        emit(0x84 | ((reg & 7) << 3));
+        emit((RDX << 3) | RBX);
+    }
+    else {
+        emit(0x80 | ((reg & 7) << 3) | RBX);
+    }
+    emit32(disp);
+}
+
+void X64Emitter::emit_reg(int reg, int rm)
+{
+    emit(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void X64Emitter::Prologue()
+{
+    emit(0x53);                 // push rbx
+    emit(0x48); emit(0x89); emit_reg(RDI, RBX); // mov rbx, rdi
+}
+
+void X64Emitter::Epilogue()
+{
+    emit(0x5B);                 // pop rbx
+    emit(0xC3);                 // ret
+}
+
+void X64Emitter::LoadByte(int reg, int32_t disp, bool indexed)
+{
+    emit(0x0F); emit(0xB6);
+    emit_mem(reg, disp, indexed);
+}
+
+void X64Emitter::StoreByte(int reg, int32_t disp, bool indexed)
+{
+    emit(0x88);
+    emit_mem(reg, disp, indexed);
+}
+
+void X64Emitter::StoreByteImm(int32_t disp, uint8_t imm)
+{
+    emit(0xC6);
+    emit_mem(0, disp, false);
+    emit(imm);
+}
+
+void X64Emitter::StoreWordImm(int32_t disp, uint16_t imm)
+{
+    emit(0x66); emit(0xC7);
+    emit_mem(0, disp, false);
+    emit(imm);
+    emit(imm >> 8);
+}
+
+void X64Emitter::Alu(int op, int reg, int src)
+{
+    emit(op);
+    emit_reg(reg, src);
+}
+
+void X64Emitter::AluToMem(int op, int32_t disp, int reg)
+{
+    emit(op - 2);
+    emit_mem(reg, disp, false);
+}
+
+void X64Emitter::AluImm(int ext, int reg, uint8_t imm)
+{
+    emit(0x80);
+    emit_reg(ext, reg);
+    emit(imm);
+}
+
+void X64Emitter::AluMemImm(int ext, int32_t disp, uint8_t imm)
+{
+    emit(0x80);
+    emit_mem(ext, disp, false);
+    emit(imm);
+}
+
+void X64Emitter::TestMemImm(int32_t disp, uint8_t imm)
+{
+    emit(0xF6);
+    emit_mem(0, disp, false);
+    emit(imm);
+}
+
+void X64Emitter::Shift(int ext, int reg, int count)
+{
+    emit(count == 1 ? 0xD0 : 0xC0);
+    emit_reg(ext, reg);
+    if (count != 1)
+        emit(count);
+}
+
+void X64Emitter::Not(int reg)
+{
+    emit(0xF6);
+    emit_reg(2, reg);
+}
+
+void X64Emitter::Inc(int reg)
+{
+    emit(0xFE);
+    emit_reg(0, reg);
+}
+
+void X64Emitter::Dec(int reg)
+{
+    emit(0xFE);
+    emit_reg(1, reg);
+}
+
+void X64Emitter::IncMem(int32_t disp)
+{
+    emit(0xFE);
+    emit_mem(0, disp, false);
+}
+
+void X64Emitter::DecMem(int32_t disp)
+{
+    emit(0xFE);
+    emit_mem(1, disp, false);
+}
+
+void X64Emitter::SetCond(int cond, int32_t disp)
+{
+    emit(0x0F); emit(0x90 | cond);
+    emit_mem(0, disp, false);
+}
+
+void X64Emitter::SetCondReg(int cond, int reg)
+{
+    emit(0x0F); emit(0x90 | cond);
+    emit_reg(0, reg);
+}
+
+void X64Emitter::AddMem64Imm(int32_t disp, int8_t imm)
+{
+    emit(0x48); emit(0x83);
+    emit_mem(0, disp, false);
+    emit(imm);
+}
+
+void X64Emitter::AddMem64Reg(int32_t disp, int reg)
+{
+    emit(0x48); emit(0x01);
+    emit_mem(reg, disp, false);
+}
+
+void X64Emitter::IncMem64(int32_t disp)
+{
+    emit(0x48); emit(0xFF);
+    emit_mem(0, disp, false);
+}
+
+void X64Emitter::MovImm(int reg, uint32_t imm)
+{
+    emit(0xB8 | (reg & 7));
+    emit32(imm);
+}
+
+void X64Emitter::Mov(int reg, int src)
+{
+    // 64 bit for pointers
+    emit(0x48); emit(0x89);
+    emit_reg(src, reg);
+}
+
+void X64Emitter::Mov32(int reg, int src)
+{
+    emit(0x89);
+    emit_reg(src, reg);
+}
+
+void X64Emitter::Call(uintptr_t func)
+{
+    // mov rax, imm64; call rax
+    emit(0x48); emit(0xB8);
+    for (int i = 0; i < 8; i++)
+        emit(static_cast<uint64_t>(func) >> (i * 8));
+    emit(0xFF); emit(0xD0);
+}
+
+size_t X64Emitter::Jump()
+{
+    emit(0xE9);
+    emit32(0);
+    return code_.size() - 4;
+}
+
+size_t X64Emitter::JumpIf(int cond)
+{
+    emit(0x0F); emit(0x80 | cond);
+    emit32(0);
+    return code_.size() - 4;
+}
+
+void X64Emitter::Bind(size_t patch)
+{
+    // rel32 from the end of the jump to here
+    const uint32_t rel = static_cast<uint32_t>(code_.size() - (patch + 4));
+    std::memcpy(&code_[patch], &rel, sizeof(rel));
+}
+
+} // namespace
@@ -0,0 +1,131 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// native code for CPU_ENGINE_JIT. x86-64 with the System V calling
+// convention. other hosts run the interpreter
+#if defined(__x86_64__) && !defined(_WIN32)
+#define NES_JIT_X64 1
+#else
+#define NES_JIT_X64 0
+#endif
+
+namespace nes {
+
+// Executable memory for generated code. Code added stays until Clear().
+// The memory is writable only while code is copied into it.
+class CodeBuffer {
+public:
+    CodeBuffer(size_t size);
+    ~CodeBuffer();
+
+    // false on hosts without a backend or when the memory is not mapped
+    static bool IsSupported();
+    bool IsOpen() const;
+
+    // nullptr when full
+    const void *Add(const std::vector<uint8_t> &code);
+    void Clear();
+
+private:
+    uint8_t *mem_ = nullptr;
+    size_t size_ = 0;
+    size_t used_ = 0;
+};
+
+enum X64Reg {
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI
+};
+
+// condition codes of jcc and setcc
+enum X64Cond {
+    X64_O = 0x0, X64_B = 0x2, X64_AE = 0x3, X64_E = 0x4, X64_NE = 0x5
+};
+
+// ALU opcodes of "op r8, r/m8". "op r/m8, r8" is the opcode - 2
+enum X64Alu {
+    X64_ADD = 0x02, X64_OR = 0x0A, X64_ADC = 0x12, X64_AND = 0x22,
+    X64_SUB = 0x2A, X64_XOR = 0x32, X64_CMP = 0x3A
+};
+
+// the /digit of "op r/m8, imm8" (80 /digit)
+enum X64AluImm {
+    X64_ADD_IMM = 0, X64_OR_IMM = 1, X64_AND_IMM = 4, X64_CMP_IMM = 7
+};
+
+// the /digit of "shift r/m8, imm8" (D0 or C0 /digit)
+enum X64Shift {
+    X64_RCL = 2, X64_RCR = 3, X64_SHL = 4, X64_SHR = 5
+};
+
+// Writes x86-64 machine code. Memory operands are [rbx + disp32], or
+// [rbx + rdx + disp32] when indexed. rbx holds the object the code works
+// on. 8 bit registers are al, cl and dl.
+class X64Emitter {
+public:
+    X64Emitter();
+
+    void Clear();
+    const std::vector<uint8_t> &GetCode() const;
+    size_t GetSize() const;
+
+    // push rbx, then rbx = rdi. the stack is aligned for calls
+    void Prologue();
+    void Epilogue();
+
+    // movzx reg32, byte [mem]
+    void LoadByte(int reg, int32_t disp, bool indexed = false);
+    // mov byte [mem], reg8
+    void StoreByte(int reg, int32_t disp, bool indexed = false);
+    void StoreByteImm(int32_t disp, uint8_t imm);
+    void StoreWordImm(int32_t disp, uint16_t imm);
+    // op reg8, src8
+    void Alu(int op, int reg, int src);
+    // op byte [mem], reg8
+    void AluToMem(int op, int32_t disp, int reg);
+    // op reg8, imm8
+    void AluImm(int ext, int reg, uint8_t imm);
+    // op byte [mem], imm8
+    void AluMemImm(int ext, int32_t disp, uint8_t imm);
+    // test byte [mem], imm8
+    void TestMemImm(int32_t disp, uint8_t imm);
+    void Shift(int ext, int reg, int count = 1);
+    void Not(int reg);
+    void Inc(int reg);
+    void Dec(int reg);
+    void IncMem(int32_t disp);
+    void DecMem(int32_t disp);
+    // setcc byte [mem] or reg8
+    void SetCond(int cond, int32_t disp);
+    void SetCondReg(int cond, int reg);
+    // 64 bit adds for the cycle and write counters
+    void AddMem64Imm(int32_t disp, int8_t imm);
+    void AddMem64Reg(int32_t disp, int reg);
+    void IncMem64(int32_t disp);
+    void MovImm(int reg, uint32_t imm);
+    void Mov(int reg, int src);
+    // zero extends to 64 bit
+    void Mov32(int reg, int src);
+    // rax is clobbered
+    void Call(uintptr_t func);
+
+    // jumps with a rel32 patched by Bind(). returns the patch position
+    size_t Jump();
+    size_t JumpIf(int cond);
+    void Bind(size_t patch);
+
+private:
+    std::vector<uint8_t> code_;
+
+    void emit(uint8_t byte);
+    void emit32(uint32_t val);
+    void emit_mem(int reg, int32_t disp, bool indexed);
+    void emit_reg(int reg, int rm);
+};
+
+} // namespace
+
+#endif // _H
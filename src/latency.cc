@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cstdio>
+#include "latency.h"
+#include "profile.h"
+#include "metrics.h"
+
+namespace nes {
+
+InputLatency::InputLatency()
+{
+}
+
+InputLatency::~InputLatency()
+{
+}
+
+void InputLatency::Press(uint8_t input, uint64_t ticks)
+{
+    const uint8_t pressed = input & ~last_input_;
+    last_input_ = input;
+
+    // released before a latch saw it. the game never read this press
+    if (stage_ == STAGE_PRESSED && !latched_ && !(input & event_.buttons))
+        stage_ = STAGE_IDLE;
+
+    if (!pressed || stage_ != STAGE_IDLE)
+        return;
+
+    event_ = LatencyEvent();
+    event_.buttons = pressed;
+    event_.press = ticks;
+    event_.press_frame = frame_count_;
+    latched_ = false;
+    stage_ = STAGE_PRESSED;
+}
+
+void InputLatency::Latch(uint8_t state)
+{
+    latched_ = (state & event_.buttons) != 0;
+
+    // a latch with the buttons was not read before they were released
+    if (stage_ == STAGE_PRESSED && !latched_ && !(last_input_ & event_.buttons))
+        stage_ = STAGE_IDLE;
+}
+
+void InputLatency::Read()
+{
+    if (stage_ != STAGE_PRESSED || !latched_)
+        return;
+
+    event_.read = GetProfileTicks();
+    event_.read_frame = frame_count_;
+    stage_ = STAGE_READ;
+}
+
+void InputLatency::EndFrame()
+{
+    frame_count_++;
+
+    if (stage_ != STAGE_READ)
+        return;
+
+    event_.end = GetProfileTicks();
+    stage_ = STAGE_ENDED;
+}
+
+void InputLatency::Present(uint64_t ticks)
+{
+    if (stage_ != STAGE_ENDED)
+        return;
+
+    event_.present = ticks;
+    events_.push_back(event_);
+    stage_ = STAGE_IDLE;
+}
+
+static double to_ms(uint64_t from, uint64_t to)
+{
+    return to > from ? TicksToMs(to - from) : 0.;
+}
+
+void InputLatency::PrintReport() const
+{
+    printf("Input latency   : %d events\n", static_cast<int>(events_.size()));
+
+    if (events_.empty())
+        return;
+
+    // frames is the number of frames rendered from the press to the
+    // presented frame. 1 when the next frame reads the button
+    printf("\n");
+    printf("%6s %6s %11s %11s %11s %11s %7s\n",
+            "frame", "button", "poll->read", "read->end", "end->swap", "total", "frames");
+
+    double min_ms = 0, max_ms = 0, sum_ms = 0;
+    uint64_t min_frames = 0, max_frames = 0, sum_frames = 0;
+
+    for (size_t i = 0; i < events_.size(); i++) {
+        const LatencyEvent &e = events_[i];
+        const double total_ms = to_ms(e.press, e.present);
+        const uint64_t frames = e.read_frame - e.press_frame + 1;
+
+        printf("%6llu     %02X %8.3f ms %8.3f ms %8.3f ms %8.3f ms %7llu\n",
+                static_cast<unsigned long long>(e.press_frame), e.buttons,
+                to_ms(e.press, e.read), to_ms(e.read, e.end), to_ms(e.end, e.present),
+                total_ms, static_cast<unsigned long long>(frames));
+
+        min_ms = i == 0 ? total_ms : std::min(min_ms, total_ms);
+        max_ms = std::max(max_ms, total_ms);
+        sum_ms += total_ms;
+        min_frames = i == 0 ? frames : std::min(min_frames, frames);
+        max_frames = std::max(max_frames, frames);
+        sum_frames += frames;
+    }
+
+    const double count = events_.size();
+
+    printf("\n");
+    printf("%13s %11s %11s %11s\n", "", "min", "mean", "max");
+    printf("%-13s %8.3f ms %8.3f ms %8.3f ms\n", "total",
+            min_ms, sum_ms / count, max_ms);
+    printf("%-13s %11llu %11.2f %11llu\n", "frames",
+            static_cast<unsigned long long>(min_frames), sum_frames / count,
+            static_cast<unsigned long long>(max_frames));
+}
+
+} // namespace
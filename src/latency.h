@@ -0,0 +1,65 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <cstdint>
+#include <vector>
+
+namespace nes {
+
+// Host ticks and emulated frames of a button press on controller 1 from
+// the input poll to the presented frame. Frames are counted by the probe
+// from the first EndFrame()
+struct LatencyEvent {
+    uint8_t buttons = 0;
+    // host ticks
+    uint64_t press = 0;
+    uint64_t read = 0;
+    uint64_t end = 0;
+    uint64_t present = 0;
+    // frames ended before each stage
+    uint64_t press_frame = 0;
+    uint64_t read_frame = 0;
+};
+
+// Input to photon latency probe. One press is tracked at a time and
+// presses while it is pending are ignored. A press released before the
+// game read it is dropped
+//   Press()    new buttons seen in the input poll
+//   Latch()    $4016 strobe latches the controller
+//   Read()     first $4016 read of a latch with the buttons
+//   EndFrame() frame with the read finished rendering
+//   Present()  the frame is on the screen
+class InputLatency {
+public:
+    InputLatency();
+    ~InputLatency();
+
+    void Press(uint8_t input, uint64_t ticks);
+    void Latch(uint8_t state);
+    void Read();
+    void EndFrame();
+    void Present(uint64_t ticks);
+
+    const std::vector<LatencyEvent> &GetEvents() const { return events_; }
+    // a line per event and min, mean and max at the end
+    void PrintReport() const;
+
+private:
+    enum Stage {
+        STAGE_IDLE = 0,
+        STAGE_PRESSED,
+        STAGE_READ,
+        STAGE_ENDED,
+    };
+
+    Stage stage_ = STAGE_IDLE;
+    LatencyEvent event_;
+    uint8_t last_input_ = 0;
+    bool latched_ = false;
+    uint64_t frame_count_ = 0;
+    std::vector<LatencyEvent> events_;
+};
+
+} // namespace
+
+#endif // _H
@@ -1,31 +1,322 @@
+#include <algorithm>
 #include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <chrono>
 #include <string>
+#include <vector>
 #include "nes.h"
 #include "cartridge.h"
+#include "movie.h"
 #include "debug.h"
+#include "profile.h"
+#include "perf_counter.h"
+#include "metrics.h"
+#include "heatmap.h"
+#include "trace.h"
+#include "exec_trace.h"
+#include "golden.h"
+#include "hash.h"
+#include "hooks.h"
+#include "alloc_count.h"
 
 using namespace nes;
 
+static void run_headless(NES &nes, const Movie &movie, uint64_t frame_count,
+        bool use_perf, FrameMetrics *metrics, HotSpotProfiler *hot, MemoryHeatmap *heatmap)
+{
+    FrameProfile prof;
+    PerfCounter perf;
+
+    if (use_perf) {
+        if (perf.Open())
+            prof.perf = &perf;
+        else
+            std::cerr << "hardware performance counters are not available" << std::endl;
+    }
+
+    InputLatency *latency = nes.GetLatencyProbe();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < frame_count; i++) {
+        nes.InputController(0, movie.GetInput(i));
+        if (latency)
+            latency->Press(movie.GetInput(i), GetProfileTicks());
+
+        if (hot) {
+            nes.UpdateFrame(*hot);
+        }
+        else if (metrics) {
+            // no texture and overlay in headless
+            const uint64_t frame_start = GetProfileTicks();
+            const std::array<uint64_t,PHASE_COUNT> start_ticks = prof.ticks;
+
+            nes.UpdateFrame(prof);
+
+            FrameTimes times;
+            GetPhaseTimes(prof, start_ticks, times);
+            times.ms[METRIC_FRAME] = TicksToMs(GetProfileTicks() - frame_start);
+
+            FrameUsage usage;
+            GetFrameUsage(nes.cpu, usage);
+            metrics->AddFrame(times, usage);
+        }
+        else if (use_perf) {
+            nes.UpdateFrame(prof);
+        }
+        else {
+            nes.UpdateFrame();
+        }
+
+        if (heatmap)
+            heatmap->EndFrame();
+        // no swap in headless. presented when the frame returns
+        if (latency)
+            latency->Present(GetProfileTicks());
+    }
+
+    if (heatmap)
+        heatmap->Flush();
+
+    const auto end = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+
+    printf("Frames          : %llu\n", static_cast<unsigned long long>(frame_count));
+    printf("Elapsed         : %.3f sec\n", elapsed);
+    printf("Speed           : %.1f fps (%.1fx)\n",
+            frame_count / elapsed, frame_count / elapsed / 60.);
+    printf("State Hash      : %016llx\n", static_cast<unsigned long long>(nes.HashState()));
+
+    if (use_perf) {
+        printf("\n");
+        PrintFrameProfile(prof);
+    }
+
+    if (hot) {
+        printf("\n");
+        hot->PrintReport(20);
+    }
+}
+
+static void run_golden(NES &nes, const Movie &movie, const std::vector<uint64_t> &hash_frames,
+        bool hash_audio, std::vector<FrameHash> &hashes)
+{
+    uint64_t audio_hash = HASH_INIT;
+    if (hash_audio)
+        nes.apu.SetSampleHash(&audio_hash);
+
+    const uint64_t frame_count = hash_frames.empty() ? 0 : hash_frames.back();
+    size_t next = 0;
+
+    for (uint64_t frame = 1; frame <= frame_count; frame++) {
+        nes.InputController(0, movie.GetInput(frame - 1));
+        nes.UpdateFrame();
+
+        if (frame != hash_frames[next])
+            continue;
+
+        FrameHash hash;
+        hash.frame = frame;
+        hash.video = nes.fbuf.GetHash();
+        hash.audio = audio_hash;
+        hash.has_audio = hash_audio;
+        hashes.push_back(hash);
+
+        while (next < hash_frames.size() && hash_frames[next] == frame)
+            next++;
+    }
+
+    nes.apu.SetSampleHash(nullptr);
+}
+
+// false when any frame after the warm-up allocates
+static bool run_alloc_check(NES &nes, const Movie &movie, uint64_t frame_count)
+{
+    const uint64_t WARMUP_FRAMES = 60;
+    const uint64_t PRINT_FRAMES = 10;
+    uint64_t alloc_frame_count = 0;
+    uint64_t alloc_count = 0;
+
+    for (uint64_t i = 0; i < WARMUP_FRAMES + frame_count; i++) {
+        const uint64_t before = GetAllocCount();
+
+        nes.InputController(0, movie.GetInput(i));
+        nes.UpdateFrame();
+
+        const uint64_t count = GetAllocCount() - before;
+        if (i < WARMUP_FRAMES || count == 0)
+            continue;
+
+        if (alloc_frame_count < PRINT_FRAMES)
+            printf("frame %llu: %llu allocations\n",
+                    static_cast<unsigned long long>(i + 1),
+                    static_cast<unsigned long long>(count));
+
+        alloc_frame_count++;
+        alloc_count += count;
+    }
+
+    printf("Allocations     : %llu in %llu of %llu frames after %llu warm-up frames\n",
+            static_cast<unsigned long long>(alloc_count),
+            static_cast<unsigned long long>(alloc_frame_count),
+            static_cast<unsigned long long>(frame_count),
+            static_cast<unsigned long long>(WARMUP_FRAMES));
+
+    return alloc_frame_count == 0;
+}
+
+static std::vector<uint64_t> parse_frame_list(const std::string &list)
+{
+    std::vector<uint64_t> frames;
+    std::istringstream iss(list);
+    std::string item;
+
+    while (std::getline(iss, item, ',')) {
+        const uint64_t frame = std::strtoull(item.c_str(), nullptr, 10);
+        if (frame > 0)
+            frames.push_back(frame);
+    }
+
+    return frames;
+}
+
 int main(int argc, char **argv)
 {
     NES nes;
     Cartridge cart;
+    Movie movie;
     const char *filename = nullptr;
+    const char *movie_filename = nullptr;
+    const char *trace_filename = nullptr;
+    const char *metrics_filename = nullptr;
+    const char *heatmap_filename = nullptr;
+    const char *exec_trace_filename = nullptr;
+    const char *print_exec_trace_filename = nullptr;
+    const char *golden_filename = nullptr;
+    const char *record_golden_filename = nullptr;
+    std::vector<uint64_t> hash_frames;
+    uint64_t frame_count = 60 * 60;
+    uint64_t heatmap_window = 0;
+    uint64_t exec_trace_ring = 0;
     bool test_mode = false;
     bool print_log = false;
+    bool headless = false;
+    bool use_perf = false;
+    bool use_hotspot = false;
+    bool hash_audio = false;
+    bool alloc_check = false;
+    bool measure_latency = false;
+    CpuEngine cpu_engine = CPU_ENGINE_BLOCK;
+    int exit_code = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
 
-    if (argc == 3 && std::string(argv[1]) == "--test-mode") {
-        test_mode = true;
-        filename = argv[2];
+        if (arg == "--test-mode") {
+            test_mode = true;
+        }
+        else if (arg == "--log") {
+            print_log = true;
+        }
+        else if (arg == "--headless") {
+            headless = true;
+        }
+        else if (arg == "--perf") {
+            use_perf = true;
+        }
+        else if (arg == "--hotspot") {
+            use_hotspot = true;
+        }
+        else if (arg == "--frames" && i + 1 < argc) {
+            frame_count = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--input" && i + 1 < argc) {
+            movie_filename = argv[++i];
+        }
+        else if (arg == "--trace" && i + 1 < argc) {
+            trace_filename = argv[++i];
+        }
+        else if (arg == "--metrics-csv" && i + 1 < argc) {
+            metrics_filename = argv[++i];
+        }
+        else if (arg == "--heatmap" && i + 1 < argc) {
+            heatmap_filename = argv[++i];
+        }
+        else if (arg == "--heatmap-window" && i + 1 < argc) {
+            heatmap_window = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--exec-trace" && i + 1 < argc) {
+            exec_trace_filename = argv[++i];
+        }
+        else if (arg == "--exec-trace-ring" && i + 1 < argc) {
+            exec_trace_ring = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--print-exec-trace" && i + 1 < argc) {
+            print_exec_trace_filename = argv[++i];
+        }
+        else if (arg == "--golden" && i + 1 < argc) {
+            golden_filename = argv[++i];
+        }
+        else if (arg == "--record-golden" && i + 1 < argc) {
+            record_golden_filename = argv[++i];
+        }
+        else if (arg == "--hash-frames" && i + 1 < argc) {
+            hash_frames = parse_frame_list(argv[++i]);
+        }
+        else if (arg == "--hash-audio") {
+            hash_audio = true;
+        }
+        else if (arg == "--alloc-check") {
+            alloc_check = true;
+        }
+        else if (arg == "--latency") {
+            measure_latency = true;
+        }
+        else if (arg == "--cpu-engine" && i + 1 < argc) {
+            const std::string engine = argv[++i];
+            if (engine == "interpreter") {
+                cpu_engine = CPU_ENGINE_INTERPRETER;
+            }
+            else if (engine == "block") {
+                cpu_engine = CPU_ENGINE_BLOCK;
+            }
+            else if (engine == "jit") {
+                cpu_engine = CPU_ENGINE_JIT;
+            }
+            else {
+                std::cerr << "unknown CPU engine: " << engine << std::endl;
+                return -1;
+            }
+        }
+        else if (arg[0] != '-' && !filename) {
+            filename = argv[i];
+        }
+        else {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return -1;
+        }
     }
-    else if (argc == 3 && std::string(argv[1]) == "--log") {
-        print_log = true;
-        filename = argv[2];
+
+    if (!DebugHooks::enabled &&
+        (test_mode || print_log || exec_trace_filename || heatmap_filename ||
+         measure_latency)) {
+        std::cerr << "debug hooks are not built in. rebuild with HOOKS=1" << std::endl;
+        return -1;
     }
-    else if (argc ==2) {
-        filename = argv[1];
+
+    // the rest of the metrics work without them
+    if (!DebugHooks::stats && metrics_filename)
+        std::cerr << "lag, NMI and spin stats are not built in. rebuild with HOOKS=1" << std::endl;
+
+    if (print_exec_trace_filename) {
+        if (!PrintExecTrace(print_exec_trace_filename)) {
+            std::cerr << print_exec_trace_filename << ": not an execution trace file" << std::endl;
+            return -1;
+        }
+        return 0;
     }
-    else {
+
+    if (!filename) {
         std::cerr << "missing file name" << std::endl;
         return -1;
     }
@@ -41,12 +332,87 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    if (movie_filename && !movie.Open(movie_filename)) {
+        std::cerr << movie_filename << ": could not open input file" << std::endl;
+        return -1;
+    }
+
     nes.InsertCartridge(&cart);
+    nes.cpu.SetEngine(cpu_engine);
+    if (nes.cpu.GetEngine() != cpu_engine)
+        std::cerr << "no JIT for this host. running the interpreter" << std::endl;
     nes.PowerUp();
 
+    // ring keeps the latest records in memory and saves them at exit
+    ExecTrace exec_trace;
+    if (exec_trace_filename) {
+        if (exec_trace_ring > 0) {
+            exec_trace.OpenRing(exec_trace_ring);
+            nes.StartExecTrace(&exec_trace);
+        }
+        else if (exec_trace.OpenFile(exec_trace_filename)) {
+            nes.StartExecTrace(&exec_trace);
+        }
+        else {
+            std::cerr << exec_trace_filename << ": could not open trace file" << std::endl;
+        }
+    }
+
     if (test_mode) {
         LogCpuStatus(nes, 8991);
     }
+    else if (golden_filename) {
+        std::vector<FrameHash> expected, actual;
+
+        if (!LoadGolden(golden_filename, expected)) {
+            std::cerr << golden_filename << ": could not read golden file" << std::endl;
+            return -1;
+        }
+
+        // frames and audio come from the golden file
+        hash_frames.clear();
+        for (const auto &hash: expected) {
+            hash_frames.push_back(hash.frame);
+            hash_audio = hash_audio || hash.has_audio;
+        }
+        std::sort(hash_frames.begin(), hash_frames.end());
+
+        run_golden(nes, movie, hash_frames, hash_audio, actual);
+
+        const int mismatch_count = CompareGolden(expected, actual);
+        printf("%s: %d/%d frames match\n", golden_filename,
+                static_cast<int>(expected.size()) - mismatch_count,
+                static_cast<int>(expected.size()));
+
+        if (mismatch_count > 0)
+            exit_code = 1;
+    }
+    else if (alloc_check) {
+        if (!IsAllocCountEnabled()) {
+            std::cerr << "allocation counting is not built in. build with make alloc" << std::endl;
+            exit_code = -1;
+        }
+        else if (!run_alloc_check(nes, movie, frame_count)) {
+            exit_code = 1;
+        }
+    }
+    else if (record_golden_filename) {
+        std::vector<FrameHash> actual;
+
+        // every second by default
+        if (hash_frames.empty()) {
+            for (uint64_t frame = 60; frame <= frame_count; frame += 60)
+                hash_frames.push_back(frame);
+        }
+        std::sort(hash_frames.begin(), hash_frames.end());
+
+        run_golden(nes, movie, hash_frames, hash_audio, actual);
+
+        if (!SaveGolden(record_golden_filename, actual)) {
+            std::cerr << record_golden_filename << ": could not write golden file" << std::endl;
+            exit_code = -1;
+        }
+    }
     else {
         std::string board_name = cart.GetBoardName();
         if (board_name != "")
@@ -60,10 +426,70 @@ int main(int argc, char **argv)
         if (print_log)
             nes.StartLog();
 
-        nes.PlayGame();
+        if (trace_filename && !StartTrace(trace_filename))
+            std::cerr << "tracing is not built in. rebuild with TRACE=1" << std::endl;
+
+        InputLatency latency;
+        if (measure_latency)
+            nes.SetLatencyProbe(&latency);
+
+        if (headless) {
+            FrameMetrics metrics;
+            const bool use_metrics = metrics_filename && metrics.OpenCsv(metrics_filename);
+
+            if (metrics_filename && !use_metrics)
+                std::cerr << metrics_filename << ": could not open metrics file" << std::endl;
+
+            HotSpotProfiler hot;
+            if (use_hotspot)
+                hot.Attach(&cart);
+
+            // one window for the whole run by default
+            MemoryHeatmap heatmap(heatmap_window ? heatmap_window : frame_count);
+            const bool use_heatmap = heatmap_filename && heatmap.OpenDump(heatmap_filename);
+
+            if (heatmap_filename && !use_heatmap)
+                std::cerr << heatmap_filename << ": could not open heatmap file" << std::endl;
+
+            if (use_heatmap) {
+                nes.cpu.SetAccessCounter(&heatmap.cpu);
+                nes.ppu.SetAccessCounter(&heatmap.ppu);
+            }
+
+            run_headless(nes, movie, frame_count, use_perf,
+                    use_metrics ? &metrics : nullptr,
+                    use_hotspot ? &hot : nullptr,
+                    use_heatmap ? &heatmap : nullptr);
+
+            nes.cpu.SetAccessCounter(nullptr);
+            nes.ppu.SetAccessCounter(nullptr);
+        }
+        else {
+            if (metrics_filename)
+                nes.SetMetricsCsv(metrics_filename);
+
+            nes.PlayGame();
+        }
+
+        if (trace_filename)
+            FinishTrace();
+
+        if (measure_latency) {
+            nes.SetLatencyProbe(nullptr);
+            printf("\n");
+            latency.PrintReport();
+        }
+    }
+
+    if (exec_trace_filename) {
+        nes.StartExecTrace(nullptr);
+        exec_trace.Close();
+
+        if (exec_trace_ring > 0 && !exec_trace.SaveRing(exec_trace_filename))
+            std::cerr << exec_trace_filename << ": could not save trace file" << std::endl;
     }
 
     nes.ShutDown();
 
-    return 0;
+    return exit_code;
 }
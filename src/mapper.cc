@@ -60,6 +60,11 @@ uint8_t Mapper::PeekPrg(uint32_t physical_addr) const
         return 0xFF;
 }
 
+const uint8_t *Mapper::GetPrgRomData(uint16_t addr) const
+{
+    return do_get_prg_rom_data(addr);
+}
+
 size_t Mapper::GetPrgRomSize() const
 {
     return prg_rom_.size();
@@ -90,7 +95,7 @@ void Mapper::GetChrBankInfo(BankInfo &info) const
     do_get_chr_bank_info(info);
 }
 
-std::vector<uint8_t> Mapper::GetPrgRam() const
+const std::vector<uint8_t> &Mapper::GetPrgRam() const
 {
     return prg_ram_;
 }
@@ -130,6 +135,16 @@ void Mapper::CpuClock()
     do_cpu_clock();
 }
 
+int Mapper::GetCyclesToIRQ() const
+{
+    return do_get_cycles_to_irq();
+}
+
+bool Mapper::IsScanlineIRQEnabled() const
+{
+    return do_is_scanline_irq_enabled();
+}
+
 int Mapper::GetMirroring() const
 {
     return mirroring_;
@@ -145,6 +160,11 @@ std::string Mapper::GetBoardName() const
     return board_name_;
 }
 
+const std::vector<uint8_t> &Mapper::get_prg_rom() const
+{
+    return prg_rom_;
+}
+
 uint8_t Mapper::read_prg_rom(int index) const
 {
     if (index >= 0 && index < GetPrgRomSize())
@@ -2,6 +2,7 @@
 #define MAPPER_H
 
 #include <cstdint>
+#include <climits>
 #include <string>
 #include <vector>
 #include <memory>
@@ -33,6 +34,9 @@ public:
     void WriteNameTable(uint16_t addr, uint8_t data);
 
     uint8_t PeekPrg(uint32_t physical_addr) const;
+    // host memory of PRG ROM at CPU $8000-$FFFF. nullptr if reads of addr
+    // need the mapper. valid until the next write to the mapper
+    const uint8_t *GetPrgRomData(uint16_t addr) const;
 
     size_t GetPrgRomSize() const;
     size_t GetChrRomSize() const;
@@ -41,7 +45,7 @@ public:
     void GetPrgBankInfo(BankInfo &info) const;
     void GetChrBankInfo(BankInfo &ifno) const;
 
-    std::vector<uint8_t> GetPrgRam() const;
+    const std::vector<uint8_t> &GetPrgRam() const;
     void SetPrgRam(const std::vector<uint8_t> &sram);
     void SetNameTable(std::array<uint8_t,2048> *nt);
     bool HasPrgRamWritten() const;
@@ -50,6 +54,10 @@ public:
     void ClearIRQ();
     void PpuClock(int cycle, int scanline);
     void CpuClock();
+    // CPU cycles until CpuClock() sets IRQ. INT_MAX if it can't
+    int GetCyclesToIRQ() const;
+    // IRQ is counted on scanlines by PpuClock() and enabled
+    bool IsScanlineIRQEnabled() const;
 
     int GetMirroring() const;
     void SetMirroring(int mirroring);
@@ -57,6 +65,7 @@ public:
     std::string GetBoardName() const;
 
 protected:
+    const std::vector<uint8_t> &get_prg_rom() const;
     uint8_t read_prg_rom(int index) const;
     uint8_t read_chr_rom(int index) const;
     uint8_t read_prg_ram(int index) const;
@@ -113,6 +122,17 @@ private:
         SERIALIZE_NAMESPACE_END(ar);
     }
 
+    friend void HashState(StateHash &h, const Mapper *data)
+    {
+        HASH_STATE(h, data, prg_ram_);
+        HASH_STATE(h, data, chr_ram_);
+        HASH_STATE(h, data, mirroring_);
+        HASH_STATE(h, data, irq_generated_);
+        HASH_STATE(h, data, prg_ram_protected_);
+        HASH_STATE(h, data, prg_ram_written_);
+        data->do_hash_state(h);
+    }
+
     virtual uint8_t do_read_prg(uint16_t addr) const = 0;
     virtual uint8_t do_read_chr(uint16_t addr) const = 0;
     virtual uint8_t do_read_nametable(uint16_t addr) const;
@@ -122,8 +142,12 @@ private:
 
     virtual void do_ppu_clock(int cycle, int scanline) {}
     virtual void do_cpu_clock() {}
+    virtual int do_get_cycles_to_irq() const { return INT_MAX; }
+    virtual bool do_is_scanline_irq_enabled() const { return false; }
     virtual void do_serialize(Archive &ar) {}
+    virtual void do_hash_state(StateHash &h) const {}
 
+    virtual const uint8_t *do_get_prg_rom_data(uint16_t addr) const { return nullptr; }
     virtual void do_get_prg_bank_info(BankInfo &info) const = 0;
     virtual void do_get_chr_bank_info(BankInfo &ifno) const = 0;
 
@@ -10,6 +10,7 @@ Mapper_000::Mapper_000(const std::vector<uint8_t> &prg_rom,
     // PRG RAM: 2 or 4 KiB, not bankswitched, only in Family Basic
     // (but most emulators provide 8)
     prg_.resize(GetPrgRomSize());
+    prg_.set_memory(get_prg_rom().data(), GetPrgRomSize());
 }
 
 Mapper_000::~Mapper_000()
@@ -32,6 +33,11 @@ uint8_t Mapper_000::do_read_prg(uint16_t addr) const
     }
 }
 
+const uint8_t *Mapper_000::do_get_prg_rom_data(uint16_t addr) const
+{
+    return prg_.data(addr - 0x8000);
+}
+
 uint8_t Mapper_000::do_read_chr(uint16_t addr) const
 {
     // CHR capacity: 8 KiB ROM (DIP-28 standard pinout) but most emulators support RAM
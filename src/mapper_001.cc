@@ -19,6 +19,7 @@ Mapper_001::Mapper_001(const std::vector<uint8_t> &prg_rom,
         const std::vector<uint8_t> &chr_rom) : Mapper(prg_rom, chr_rom)
 {
     prg_.resize(GetPrgRomSize());
+    prg_.set_memory(get_prg_rom().data(), GetPrgRomSize());
     chr_.resize(GetChrRomSize());
 
     shift_register_ = 0x10;
@@ -55,6 +56,11 @@ uint8_t Mapper_001::do_read_prg(uint16_t addr) const
     }
 }
 
+const uint8_t *Mapper_001::do_get_prg_rom_data(uint16_t addr) const
+{
+    return prg_.data(addr - 0x8000);
+}
+
 uint8_t Mapper_001::do_read_chr(uint16_t addr) const
 {
     if (addr >= 0x0000 && addr <= 0x1FFF) {
@@ -38,6 +38,19 @@ private:
         SERIALIZE(ar, this, mmc3_board_);
     }
 
+    void do_hash_state(StateHash &h) const override final
+    {
+        HASH_STATE(h, this, prg_);
+        HASH_STATE(h, this, chr_);
+        HASH_STATE(h, this, prg_ram_bank_);
+        HASH_STATE(h, this, shift_register_);
+        HASH_STATE(h, this, control_register_);
+        HASH_STATE(h, this, prg_mode_);
+        HASH_STATE(h, this, chr_mode_);
+        HASH_STATE(h, this, prg_ram_disabled_);
+        HASH_STATE(h, this, mmc3_board_);
+    }
+
     void select_board();
     void write_chr_bank(int window, uint8_t data);
 
@@ -48,6 +61,7 @@ private:
     uint8_t do_read_chr(uint16_t addr) const override final;
     void do_write_prg(uint16_t addr, uint8_t data) override final;
     void do_write_chr(uint16_t addr, uint8_t data) override final;
+    const uint8_t *do_get_prg_rom_data(uint16_t addr) const override final;
 
     void do_get_prg_bank_info(BankInfo &info) const override;
     void do_get_chr_bank_info(BankInfo &ifno) const override;
@@ -8,6 +8,7 @@ Mapper_002::Mapper_002(const std::vector<uint8_t> &prg_rom,
     // CPU $8000-$BFFF: 16 KB switchable PRG ROM bank
     // CPU $C000-$FFFF: 16 KB PRG ROM bank, fixed to the last bank
     prg_.resize(GetPrgRomSize());
+    prg_.set_memory(get_prg_rom().data(), GetPrgRomSize());
     prg_.select(1, -1);
 
     use_chr_ram(0x2000); // 8KB
@@ -28,6 +29,11 @@ uint8_t Mapper_002::do_read_prg(uint16_t addr) const
     }
 }
 
+const uint8_t *Mapper_002::do_get_prg_rom_data(uint16_t addr) const
+{
+    return prg_.data(addr - 0x8000);
+}
+
 uint8_t Mapper_002::do_read_chr(uint16_t addr) const
 {
     if (addr >= 0x0000 && addr <= 0x1FFF)
@@ -20,10 +20,16 @@ private:
         SERIALIZE(ar, this, prg_);
     }
 
+    void do_hash_state(StateHash &h) const override final
+    {
+        HASH_STATE(h, this, prg_);
+    }
+
     uint8_t do_read_prg(uint16_t addr) const override final;
     uint8_t do_read_chr(uint16_t addr) const override final;
     void do_write_prg(uint16_t addr, uint8_t data) override final;
     void do_write_chr(uint16_t addr, uint8_t data) override final;
+    const uint8_t *do_get_prg_rom_data(uint16_t addr) const override final;
 
     void do_get_prg_bank_info(BankInfo &info) const override;
     void do_get_chr_bank_info(BankInfo &ifno) const override;
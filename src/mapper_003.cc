@@ -11,6 +11,7 @@ Mapper_003::Mapper_003(const std::vector<uint8_t> &prg_rom,
     // CHR capacity: Up to 2048 KiB ROM
     // CHR bank size: 8 KiB
     prg_.resize(GetPrgRomSize());
+    prg_.set_memory(get_prg_rom().data(), GetPrgRomSize());
     chr_.resize(GetChrRomSize());
 }
 
@@ -29,6 +30,11 @@ uint8_t Mapper_003::do_read_prg(uint16_t addr) const
     }
 }
 
+const uint8_t *Mapper_003::do_get_prg_rom_data(uint16_t addr) const
+{
+    return prg_.data(addr - 0x8000);
+}
+
 uint8_t Mapper_003::do_read_chr(uint16_t addr) const
 {
     if (addr >= 0x0000 && addr <= 0x1FFF) {
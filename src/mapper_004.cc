@@ -6,6 +6,7 @@ Mapper_004::Mapper_004(const std::vector<uint8_t> &prg_rom,
         const std::vector<uint8_t> &chr_rom) : Mapper(prg_rom, chr_rom)
 {
     prg_.resize(GetPrgRomSize());
+    prg_.set_memory(get_prg_rom().data(), GetPrgRomSize());
     chr_.resize(GetChrRomSize());
     prg_.select(2, -2);
     prg_.select(3, -1);
@@ -37,6 +38,11 @@ uint8_t Mapper_004::do_read_prg(uint16_t addr) const
     }
 }
 
+const uint8_t *Mapper_004::do_get_prg_rom_data(uint16_t addr) const
+{
+    return prg_.data(addr - 0x8000);
+}
+
 uint8_t Mapper_004::do_read_chr(uint16_t addr) const
 {
     if (is_chr_ram_used()) {
@@ -275,6 +281,11 @@ void Mapper_004::do_get_chr_bank_info(BankInfo &info) const
     GetBankInfo(chr_, info);
 }
 
+bool Mapper_004::do_is_scanline_irq_enabled() const
+{
+    return irq_enabled_;
+}
+
 void Mapper_004::do_ppu_clock(int cycle, int scanline)
 {
     if (cycle != 261)
@@ -42,6 +42,20 @@ private:
         SERIALIZE(ar, this, irq_reload_);
     }
 
+    void do_hash_state(StateHash &h) const override final
+    {
+        HASH_STATE(h, this, prg_);
+        HASH_STATE(h, this, chr_);
+        HASH_STATE(h, this, bank_registers_);
+        HASH_STATE(h, this, bank_select_);
+        HASH_STATE(h, this, prg_bank_mode_);
+        HASH_STATE(h, this, chr_bank_mode_);
+        HASH_STATE(h, this, irq_counter_);
+        HASH_STATE(h, this, irq_latch_);
+        HASH_STATE(h, this, irq_enabled_);
+        HASH_STATE(h, this, irq_reload_);
+    }
+
     void update_prg_bank_mapping();
     void update_chr_bank_mapping();
     void set_bank_select(uint16_t addr, uint8_t data);
@@ -57,11 +71,13 @@ private:
     uint8_t do_read_chr(uint16_t addr) const override final;
     void do_write_prg(uint16_t addr, uint8_t data) override final;
     void do_write_chr(uint16_t addr, uint8_t data) override final;
+    const uint8_t *do_get_prg_rom_data(uint16_t addr) const override final;
 
     void do_get_prg_bank_info(BankInfo &info) const override;
     void do_get_chr_bank_info(BankInfo &ifno) const override;
 
     void do_ppu_clock(int cycle, int scanline) override final;
+    bool do_is_scanline_irq_enabled() const override final;
 };
 
 } // namespace
@@ -6,6 +6,7 @@ Mapper_010::Mapper_010(const std::vector<uint8_t> &prg_rom,
         const std::vector<uint8_t> &chr_rom) : Mapper(prg_rom, chr_rom)
 {
     prg_.resize(GetPrgRomSize());
+    prg_.set_memory(get_prg_rom().data(), GetPrgRomSize());
     chr_fd_.resize(GetChrRomSize());
     chr_fe_.resize(GetChrRomSize());
     prg_.select(1, -1);
@@ -35,6 +36,11 @@ uint8_t Mapper_010::do_read_prg(uint16_t addr) const
     }
 }
 
+const uint8_t *Mapper_010::do_get_prg_rom_data(uint16_t addr) const
+{
+    return prg_.data(addr - 0x8000);
+}
+
 uint8_t Mapper_010::do_read_chr(uint16_t addr) const
 {
 	uint8_t data = 0xFF;
@@ -161,7 +167,7 @@ void Mapper_010::do_get_prg_bank_info(BankInfo &info) const
 
 void Mapper_010::do_get_chr_bank_info(BankInfo &info) const
 {
-    info.selected.resize(2);
+    info.window_count = 2;
 
     if (latch_0_ == 0xFD) {
         info.selected[0] = chr_fd_.bank(0);
@@ -6,6 +6,7 @@ Mapper_019::Mapper_019(const std::vector<uint8_t> &prg_rom,
         const std::vector<uint8_t> &chr_rom) : Mapper(prg_rom, chr_rom)
 {
     prg_.resize(GetPrgRomSize());
+    prg_.set_memory(get_prg_rom().data(), GetPrgRomSize());
     chr_.resize(GetChrRomSize());
 
     prg_.select(3, -1);
@@ -52,6 +53,11 @@ uint8_t Mapper_019::do_read_prg(uint16_t addr) const
     return 0x00;
 }
 
+const uint8_t *Mapper_019::do_get_prg_rom_data(uint16_t addr) const
+{
+    return prg_.data(addr - 0x8000);
+}
+
 uint8_t Mapper_019::do_read_chr(uint16_t addr) const
 {
     if (addr >= 0x0000 && addr <= 0x1FFF)
@@ -287,4 +293,13 @@ void Mapper_019::do_cpu_clock()
         irq_counter_++;
 }
 
+int Mapper_019::do_get_cycles_to_irq() const
+{
+    if (!irq_enabled_)
+        return INT_MAX;
+
+    // counts up to $7FFF and sets IRQ on the next clock
+    return 0x7FFF - irq_counter_ + 1;
+}
+
 } // namespace
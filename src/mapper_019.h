@@ -40,6 +40,17 @@ private:
         SERIALIZE(ar, this, bank_select_);
     }
 
+    void do_hash_state(StateHash &h) const override final
+    {
+        HASH_STATE(h, this, prg_);
+        HASH_STATE(h, this, chr_);
+        HASH_STATE(h, this, enable_nt_lo_);
+        HASH_STATE(h, this, enable_nt_hi_);
+        HASH_STATE(h, this, irq_enabled_);
+        HASH_STATE(h, this, irq_counter_);
+        HASH_STATE(h, this, bank_select_);
+    }
+
     uint8_t read_chr(uint16_t addr) const;
     void write_chr(uint16_t addr, uint8_t data);
 
@@ -48,12 +59,14 @@ private:
     uint8_t do_read_nametable(uint16_t addr) const override final;
     void do_write_prg(uint16_t addr, uint8_t data) override final;
     void do_write_chr(uint16_t addr, uint8_t data) override final;
+    const uint8_t *do_get_prg_rom_data(uint16_t addr) const override final;
     void do_write_nametable(uint16_t addr, uint8_t data) override final;
 
     void do_get_prg_bank_info(BankInfo &info) const override;
     void do_get_chr_bank_info(BankInfo &ifno) const override;
 
     void do_cpu_clock() override final;
+    int do_get_cycles_to_irq() const override final;
 };
 
 } // namespace
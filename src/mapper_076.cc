@@ -6,6 +6,7 @@ Mapper_076::Mapper_076(const std::vector<uint8_t> &prg_rom,
         const std::vector<uint8_t> &chr_rom) : Mapper(prg_rom, chr_rom)
 {
     prg_.resize(GetPrgRomSize());
+    prg_.set_memory(get_prg_rom().data(), GetPrgRomSize());
     chr_.resize(GetChrRomSize());
     prg_.select(2, -2);
     prg_.select(3, -1);
@@ -30,6 +31,11 @@ uint8_t Mapper_076::do_read_prg(uint16_t addr) const
     }
 }
 
+const uint8_t *Mapper_076::do_get_prg_rom_data(uint16_t addr) const
+{
+    return prg_.data(addr - 0x8000);
+}
+
 uint8_t Mapper_076::do_read_chr(uint16_t addr) const
 {
     if (addr >= 0x0000 && addr <= 0x1FFF) {
@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <cmath>
+#include "metrics.h"
+#include "cpu.h"
+#include "hooks.h"
+
+namespace nes {
+
+const char *GetMetricName(int id)
+{
+    static const char *names[] = {
+        "cpu", "ppu", "apu", "mapper", "audio", "openal", "texture", "overlay", "frame"
+    };
+    static_assert(sizeof(names) / sizeof(names[0]) == METRIC_COUNT,
+            "metric names do not match MetricId");
+
+    if (id >= 0 && id < METRIC_COUNT)
+        return names[id];
+    else
+        return "";
+}
+
+void GetFrameUsage(const CPU &cpu, FrameUsage &usage)
+{
+    const CpuFrameStats &stats = cpu.GetFrameStats();
+
+    usage.cpu_cycles = cpu.GetTotalCycles() - stats.start_cycle;
+    usage.has_stats = DebugHooks::stats;
+    if (!usage.has_stats)
+        return;
+
+    usage.nmi_cycle = stats.nmi_fired ? stats.nmi_cycle - stats.start_cycle : -1;
+    usage.nmi_handler_cycles = stats.nmi_returned ? stats.nmi_handler_cycles : -1;
+    usage.spin_cycles = stats.spin_cycles;
+    usage.lag = !stats.controller_read;
+}
+
+double TicksToMs(uint64_t ticks)
+{
+    return ticks * 1e3 / GetProfileTicksPerSecond();
+}
+
+void GetPhaseTimes(const FrameProfile &prof,
+        const std::array<uint64_t,PHASE_COUNT> &start_ticks, FrameTimes &times)
+{
+    std::array<uint64_t,PHASE_COUNT> ticks;
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+        ticks[phase] = prof.ticks[phase] - start_ticks[phase];
+
+    times.ms[METRIC_CPU]    = TicksToMs(ticks[PHASE_CPU] + ticks[PHASE_DMA]);
+    times.ms[METRIC_PPU]    = TicksToMs(ticks[PHASE_PPU]);
+    times.ms[METRIC_APU]    = TicksToMs(ticks[PHASE_APU]);
+    times.ms[METRIC_MAPPER] = TicksToMs(ticks[PHASE_CART]);
+    times.ms[METRIC_AUDIO]  = TicksToMs(ticks[PHASE_AUDIO]);
+}
+
+FrameMetrics::FrameMetrics()
+{
+}
+
+FrameMetrics::~FrameMetrics()
+{
+    if (csv_)
+        fclose(csv_);
+}
+
+bool FrameMetrics::OpenCsv(const std::string &filename)
+{
+    if (csv_)
+        fclose(csv_);
+
+    csv_ = fopen(filename.c_str(), "w");
+    if (!csv_)
+        return false;
+
+    fprintf(csv_, "frame");
+    for (int id = 0; id < METRIC_COUNT; id++)
+        fprintf(csv_, ",%s_ms", GetMetricName(id));
+    fprintf(csv_, ",cpu_cycles,nmi_cycle,nmi_handler_cycles,spin_cycles,lag");
+    fprintf(csv_, ",queued_samples,underruns,overruns,speed_factor,speed_changed\n");
+
+    return true;
+}
+
+bool FrameMetrics::IsCsvOpen() const
+{
+    return csv_ != nullptr;
+}
+
+void FrameMetrics::AddFrame(const FrameTimes &times, const FrameUsage &usage,
+        const AudioFrameStats &audio)
+{
+    window_[frame_ % WINDOW_SIZE] = times;
+    usage_window_[frame_ % WINDOW_SIZE] = usage;
+    audio_window_[frame_ % WINDOW_SIZE] = audio;
+
+    if (csv_) {
+        fprintf(csv_, "%llu", static_cast<unsigned long long>(frame_));
+        for (int id = 0; id < METRIC_COUNT; id++)
+            fprintf(csv_, ",%.4f", times.ms[id]);
+        fprintf(csv_, ",%llu", static_cast<unsigned long long>(usage.cpu_cycles));
+        if (usage.has_stats)
+            fprintf(csv_, ",%lld,%lld,%llu,%d",
+                    static_cast<long long>(usage.nmi_cycle),
+                    static_cast<long long>(usage.nmi_handler_cycles),
+                    static_cast<unsigned long long>(usage.spin_cycles),
+                    usage.lag);
+        else
+            // not built in
+            fprintf(csv_, ",,,,");
+        fprintf(csv_, ",%d,%d,%d,%.3f,%d\n",
+                audio.queued_samples, audio.underruns, audio.overruns,
+                audio.speed_factor, audio.speed_changed);
+    }
+
+    frame_++;
+}
+
+int FrameMetrics::GetWindowCount() const
+{
+    return static_cast<int>(std::min<uint64_t>(frame_, WINDOW_SIZE));
+}
+
+double FrameMetrics::GetAverage(int id) const
+{
+    const int N = GetWindowCount();
+    if (N == 0)
+        return 0;
+
+    double sum = 0;
+    for (int i = 0; i < N; i++)
+        sum += window_[i].ms[id];
+
+    return sum / N;
+}
+
+double FrameMetrics::GetP99(int id) const
+{
+    const int N = GetWindowCount();
+    if (N == 0)
+        return 0;
+
+    std::array<double,WINDOW_SIZE> values;
+    for (int i = 0; i < N; i++)
+        values[i] = window_[i].ms[id];
+
+    const int index = std::min(N - 1, N * 99 / 100);
+    std::nth_element(values.begin(), values.begin() + index, values.begin() + N);
+
+    return values[index];
+}
+
+double FrameMetrics::GetJitter() const
+{
+    const int N = GetWindowCount();
+    if (N == 0)
+        return 0;
+
+    const double avg = GetAverage(METRIC_FRAME);
+    double sum = 0;
+
+    for (int i = 0; i < N; i++) {
+        const double diff = window_[i].ms[METRIC_FRAME] - avg;
+        sum += diff * diff;
+    }
+
+    return std::sqrt(sum / N);
+}
+
+void FrameMetrics::GetHistogram(std::array<int,HISTOGRAM_BINS> &hist) const
+{
+    const int N = GetWindowCount();
+    hist.fill(0);
+
+    for (int i = 0; i < N; i++) {
+        const int bin = static_cast<int>(window_[i].ms[METRIC_FRAME] / HISTOGRAM_BIN_MS);
+        hist[std::min(std::max(bin, 0), HISTOGRAM_BINS - 1)]++;
+    }
+}
+
+double FrameMetrics::GetAverageNmiCycle() const
+{
+    const int N = GetWindowCount();
+    double sum = 0;
+    int count = 0;
+
+    for (int i = 0; i < N; i++) {
+        if (usage_window_[i].nmi_cycle < 0)
+            continue;
+        sum += usage_window_[i].nmi_cycle;
+        count++;
+    }
+
+    return count ? sum / count : 0;
+}
+
+double FrameMetrics::GetAverageNmiHandlerCycles() const
+{
+    const int N = GetWindowCount();
+    double sum = 0;
+    int count = 0;
+
+    for (int i = 0; i < N; i++) {
+        if (usage_window_[i].nmi_handler_cycles < 0)
+            continue;
+        sum += usage_window_[i].nmi_handler_cycles;
+        count++;
+    }
+
+    return count ? sum / count : 0;
+}
+
+double FrameMetrics::GetCpuUsage() const
+{
+    const int N = GetWindowCount();
+    uint64_t cycles = 0;
+    uint64_t spin = 0;
+
+    for (int i = 0; i < N; i++) {
+        cycles += usage_window_[i].cpu_cycles;
+        spin += usage_window_[i].spin_cycles;
+    }
+
+    return cycles ? 1. - static_cast<double>(spin) / cycles : 0;
+}
+
+int FrameMetrics::GetLagFrameCount() const
+{
+    const int N = GetWindowCount();
+    int count = 0;
+
+    for (int i = 0; i < N; i++)
+        count += usage_window_[i].lag;
+
+    return count;
+}
+
+double FrameMetrics::GetAverageQueuedSamples() const
+{
+    const int N = GetWindowCount();
+    if (N == 0)
+        return 0;
+
+    double sum = 0;
+    for (int i = 0; i < N; i++)
+        sum += audio_window_[i].queued_samples;
+
+    return sum / N;
+}
+
+int FrameMetrics::GetMinQueuedSamples() const
+{
+    const int N = GetWindowCount();
+    if (N == 0)
+        return 0;
+
+    int min = audio_window_[0].queued_samples;
+    for (int i = 1; i < N; i++)
+        min = std::min(min, audio_window_[i].queued_samples);
+
+    return min;
+}
+
+int FrameMetrics::GetUnderrunCount() const
+{
+    const int N = GetWindowCount();
+    int count = 0;
+
+    for (int i = 0; i < N; i++)
+        count += audio_window_[i].underruns;
+
+    return count;
+}
+
+int FrameMetrics::GetOverrunCount() const
+{
+    const int N = GetWindowCount();
+    int count = 0;
+
+    for (int i = 0; i < N; i++)
+        count += audio_window_[i].overruns;
+
+    return count;
+}
+
+int FrameMetrics::GetSpeedChangeCount() const
+{
+    const int N = GetWindowCount();
+    int count = 0;
+
+    for (int i = 0; i < N; i++)
+        count += audio_window_[i].speed_changed;
+
+    return count;
+}
+
+float FrameMetrics::GetSpeedFactor() const
+{
+    if (frame_ == 0)
+        return 1.f;
+
+    return audio_window_[(frame_ - 1) % WINDOW_SIZE].speed_factor;
+}
+
+} // namespace
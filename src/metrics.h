@@ -0,0 +1,107 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <array>
+#include <string>
+#include "profile.h"
+#include "sound.h"
+
+namespace nes {
+
+class CPU;
+
+enum MetricId {
+    METRIC_CPU = 0,
+    METRIC_PPU,
+    METRIC_APU,
+    METRIC_MAPPER,
+    METRIC_AUDIO,
+    METRIC_OPENAL,
+    METRIC_TEXTURE,
+    METRIC_OVERLAY,
+    METRIC_FRAME,
+    METRIC_COUNT
+};
+
+// milliseconds spent in each subsystem in one frame
+struct FrameTimes {
+    std::array<double,METRIC_COUNT> ms = {0};
+};
+
+// CPU usage of one frame in CPU cycles from CPU::GetFrameStats()
+struct FrameUsage {
+    uint64_t cpu_cycles = 0;
+    // from the start of the frame. -1 if NMI did not fire
+    int64_t nmi_cycle = -1;
+    // -1 if no NMI handler returned
+    int64_t nmi_handler_cycles = -1;
+    uint64_t spin_cycles = 0;
+    // the controller ports were not read
+    bool lag = false;
+    // false if the stats are not built in (HOOKS=0). only cpu_cycles is set
+    bool has_stats = false;
+};
+
+void GetFrameUsage(const CPU &cpu, FrameUsage &usage);
+
+// CPU (with DMA), PPU, APU, mapper and audio times added to the profile
+// since its ticks were start_ticks
+void GetPhaseTimes(const FrameProfile &prof,
+        const std::array<uint64_t,PHASE_COUNT> &start_ticks, FrameTimes &times);
+double TicksToMs(uint64_t ticks);
+
+const char *GetMetricName(int id);
+
+// Rolling window of frame times with a CSV stream of one row per frame
+class FrameMetrics {
+public:
+    static constexpr int WINDOW_SIZE = 120;
+    static constexpr int HISTOGRAM_BINS = 9;
+    static constexpr double HISTOGRAM_BIN_MS = 4.;
+
+    FrameMetrics();
+    ~FrameMetrics();
+
+    bool OpenCsv(const std::string &filename);
+    bool IsCsvOpen() const;
+
+    void AddFrame(const FrameTimes &times, const FrameUsage &usage,
+            const AudioFrameStats &audio = AudioFrameStats());
+
+    double GetAverage(int id) const;
+    double GetP99(int id) const;
+    // standard deviation of frame time
+    double GetJitter() const;
+    // frame time count per 4ms bin. the last bin has the rest
+    void GetHistogram(std::array<int,HISTOGRAM_BINS> &hist) const;
+    int GetWindowCount() const;
+
+    // averages over frames where the NMI fired and its handler returned
+    double GetAverageNmiCycle() const;
+    double GetAverageNmiHandlerCycles() const;
+    // share of CPU cycles not spent in busy waits
+    double GetCpuUsage() const;
+    int GetLagFrameCount() const;
+
+    // audio queue in samples and counts over the window
+    double GetAverageQueuedSamples() const;
+    int GetMinQueuedSamples() const;
+    int GetUnderrunCount() const;
+    int GetOverrunCount() const;
+    int GetSpeedChangeCount() const;
+    // of the latest frame
+    float GetSpeedFactor() const;
+
+private:
+    std::array<FrameTimes,WINDOW_SIZE> window_;
+    std::array<FrameUsage,WINDOW_SIZE> usage_window_;
+    std::array<AudioFrameStats,WINDOW_SIZE> audio_window_;
+    uint64_t frame_ = 0;
+    FILE *csv_ = nullptr;
+};
+
+} // namespace
+
+#endif // _H
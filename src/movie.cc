@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include "movie.h"
+
+namespace nes {
+
+Movie::Movie()
+{
+}
+
+Movie::~Movie()
+{
+}
+
+static uint8_t parse_buttons(const std::string &field)
+{
+    // RLDUTSBA -> bit 0 to 7, which is the same order as the controller
+    // shift register (A is read first)
+    uint8_t input = 0x00;
+    const int N = std::min(static_cast<int>(field.size()), 8);
+
+    for (int i = 0; i < N; i++) {
+        if (field[i] != '.' && field[i] != ' ')
+            input |= 1 << i;
+    }
+
+    return input;
+}
+
+bool Movie::Open(const char *filename)
+{
+    std::ifstream ifs(filename);
+    if (!ifs)
+        return false;
+
+    inputs_.clear();
+
+    std::string line;
+    while (std::getline(ifs, line)) {
+        // header lines are "key value" pairs. skip them
+        if (line.empty() || line[0] != '|')
+            continue;
+
+        // |commands|port0|port1|port2|
+        const size_t port0 = line.find('|', 1);
+        if (port0 == std::string::npos)
+            continue;
+
+        const size_t end = line.find('|', port0 + 1);
+        const size_t len = end == std::string::npos ? std::string::npos : end - port0 - 1;
+
+        inputs_.push_back(parse_buttons(line.substr(port0 + 1, len)));
+    }
+
+    return true;
+}
+
+uint8_t Movie::GetInput(uint64_t frame) const
+{
+    if (frame < inputs_.size())
+        return inputs_[frame];
+    else
+        return 0x00;
+}
+
+uint64_t Movie::GetFrameCount() const
+{
+    return inputs_.size();
+}
+
+} // namespace
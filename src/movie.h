@@ -0,0 +1,29 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <cstdint>
+#include <vector>
+
+namespace nes {
+
+// Recorded controller inputs, one entry per frame.
+// Reads the input lines of FCEUX movie files (*.fm2)
+//   |0|RLDUTSBA|||
+// where each button is any character other than '.' or ' ' when pressed.
+class Movie {
+public:
+    Movie();
+    ~Movie();
+
+    bool Open(const char *filename);
+
+    uint8_t GetInput(uint64_t frame) const;
+    uint64_t GetFrameCount() const;
+
+private:
+    std::vector<uint8_t> inputs_;
+};
+
+} // namespace
+
+#endif // _H
@@ -1,9 +1,12 @@
+#include <algorithm>
 #include "nes.h"
 #include "framebuffer.h"
 #include "cartridge.h"
 #include "display.h"
 #include "sound.h"
 #include "debug.h"
+#include "trace.h"
+#include "hooks.h"
 
 namespace nes {
 
@@ -57,53 +60,138 @@ void NES::PlayGame()
 {
     Display disp(*this);
 
+    if (!metrics_csv_.empty() && !disp.OpenMetricsCsv(metrics_csv_))
+        printf("%s: could not open metrics file\n", metrics_csv_.c_str());
+
     InitSound();
     send_initial_samples();
+    GetSoundStats(sound_stats_);
 
+    audio_enabled_ = true;
     is_running_ = true;
 
     disp.Open();
     FinishSound();
 
+    audio_enabled_ = false;
     is_running_ = false;
 }
 
+void NES::SetMetricsCsv(const std::string &filename)
+{
+    metrics_csv_ = filename;
+}
+
+uint64_t NES::HashState() const
+{
+    // same members as Serialize(). the using brings back the HashState()
+    // of the components hidden by this member function
+    using nes::HashState;
+    StateHash h;
+
+    HASH_STATE(h, this, cpu);
+    HASH_STATE(h, this, ppu);
+    HASH_STATE(h, this, apu);
+    HASH_STATE(h, this, dma);
+    HASH_STATE(h, this, frame_);
+    if (cart_)
+        HashState(h, cart_);
+
+    return h.Get();
+}
+
+void NES::SetLatencyProbe(InputLatency *latency)
+{
+    latency_ = latency;
+    cpu.SetLatencyProbe(latency);
+}
+
 void NES::StartLog()
 {
     do_log_ = true;
 }
 
+void NES::StartExecTrace(ExecTrace *trace)
+{
+    exec_trace_ = trace;
+}
+
+bool NES::need_step() const
+{
+    // breaks and logs look at every instruction
+    if (DebugHooks::step && breakat_ != NOWHERE && breakat_ != NEXT_FRAME)
+        return true;
+
+    return DebugHooks::log && need_log();
+}
+
+int NES::get_cycles_to_event() const
+{
+    // the CPU sees interrupts and the frame end in the instruction
+    // they happen in
+    int cycles = ppu.GetCyclesToEvent();
+    cycles = std::min(cycles, apu.GetCyclesToIRQ());
+    cycles = std::min(cycles, cart_->GetCyclesToIRQ());
+
+    return cycles;
+}
+
 bool NES::need_log() const
 {
-    return do_log_ && !cpu.IsSuspended();
+    return (do_log_ || exec_trace_) && !cpu.IsSuspended();
 }
 
-void NES::update_audio_speed()
+void NES::log_instruction()
 {
-    static constexpr int WARN_SPEED_CHANGE = 0;
+    ExecRecord rec;
+    CaptureExecRecord(cpu, ppu, rec);
+
+    if (exec_trace_)
+        exec_trace_->Add(rec);
+
+    if (do_log_)
+        printf("%s\n", FormatExecRecord(rec).c_str());
 
+    log_line_count_++;
+}
+
+void NES::update_audio_speed()
+{
     const int count = GetQueuedSampleCount();
     const float ratio = count / 735.f;
-    static bool normal = true;
-
-    if (ratio < 3.5 && normal) {
-        apu.SetSpeedFactor(0.995);
-        normal = false;
-        if (WARN_SPEED_CHANGE) {
-            printf("--- audio slow down\n");
-        }
-    }
-    else if (ratio > 5.5 && !normal) {
-        apu.SetSpeedFactor(1);
-        normal = true;
-        if (WARN_SPEED_CHANGE) {
-            printf("+++ audio normal speed\n");
-        }
+    float factor = 0;
+
+    if (ratio < 3.5 && !audio_slow_)
+        factor = 0.995f;
+    else if (ratio > 5.5 && audio_slow_)
+        factor = 1.f;
+
+    audio_stats_.speed_changed = factor > 0;
+    if (factor > 0) {
+        apu.SetSpeedFactor(factor);
+        audio_slow_ = !audio_slow_;
+        audio_stats_.speed_factor = factor;
     }
 }
 
+void NES::update_audio_stats()
+{
+    SoundStats stats;
+    GetSoundStats(stats);
+
+    audio_stats_.queued_samples = stats.queued_samples;
+    audio_stats_.underruns = stats.underrun_count - sound_stats_.underrun_count;
+    audio_stats_.overruns = stats.overrun_count - sound_stats_.overrun_count;
+    audio_stats_.al_ticks = stats.al_ticks - sound_stats_.al_ticks;
+
+    sound_stats_ = stats;
+}
+
 bool NES::handle_break_condition(bool frame_rendered)
 {
+    if (!DebugHooks::step)
+        return frame_rendered;
+
     if (breakat_ == NEXT_INSTRUCTION) {
         Pause();
         return true;
@@ -129,36 +217,201 @@ bool NES::handle_break_condition(bool frame_rendered)
     return false;
 }
 
+// measures nothing. compiled away in UpdateFrame()
+struct NullProbe {
+    static constexpr bool per_instruction = false;
+
+    void Start() {}
+    void Fetch() {}
+    void Lap(int phase) {}
+    void Step(int cpu_cycles) {}
+};
+
+// charges time since the previous lap to the phase
+struct ProfileProbe {
+    ProfileProbe(FrameProfile &p) : prof(p) {}
+    static constexpr bool per_instruction = false;
+    FrameProfile &prof;
+    uint64_t last = 0;
+    PerfSample last_events;
+
+    void Start()
+    {
+        last = GetProfileTicks();
+
+        if (prof.perf)
+            prof.perf->Read(last_events);
+    }
+
+    void Fetch() {}
+
+    void Lap(int phase)
+    {
+        const uint64_t now = GetProfileTicks();
+        prof.ticks[phase] += now - last;
+        last = now;
+
+        if (prof.perf) {
+            PerfSample events;
+            prof.perf->Read(events);
+
+            for (int i = 0; i < PERF_EVENT_COUNT; i++)
+                prof.events[phase].values[i] += events.values[i] - last_events.values[i];
+            last_events = events;
+        }
+    }
+
+    void Step(int cpu_cycles)
+    {
+        prof.cpu_cycles += cpu_cycles;
+    }
+};
+
+// counts cycles of each instruction. DMA steps are not counted
+struct HotSpotProbe {
+    HotSpotProbe(HotSpotProfiler &h, const CPU &c) : hot(h), cpu(c) {}
+    static constexpr bool per_instruction = true;
+    HotSpotProfiler &hot;
+    const CPU &cpu;
+    bool fetched = false;
+
+    void Start() {}
+
+    void Fetch()
+    {
+        hot.Fetch(cpu);
+        fetched = true;
+    }
+
+    void Lap(int phase) {}
+
+    void Step(int cpu_cycles)
+    {
+        if (fetched)
+            hot.Retire(cpu, cpu_cycles);
+        fetched = false;
+    }
+};
+
+#if NES_TRACE >= 2
+// a trace event per phase of every step
+struct TraceProbe {
+    static constexpr bool per_instruction = false;
+    uint64_t last = 0;
+
+    void Start()
+    {
+        last = GetProfileTicks();
+    }
+
+    void Fetch() {}
+
+    void Lap(int phase)
+    {
+        const uint64_t now = GetProfileTicks();
+        AddTraceEvent(GetPhaseName(phase), last, now);
+        last = now;
+    }
+
+    void Step(int cpu_cycles) {}
+};
+#endif
+
 void NES::UpdateFrame()
+{
+    TRACE_SCOPE("UpdateFrame");
+#if NES_TRACE >= 2
+    TraceProbe probe;
+#else
+    NullProbe probe;
+#endif
+    update_frame(probe);
+}
+
+void NES::UpdateFrame(FrameProfile &prof)
+{
+    TRACE_SCOPE("UpdateFrame");
+    ProfileProbe probe(prof);
+    update_frame(probe);
+    prof.frames++;
+}
+
+void NES::UpdateFrame(HotSpotProfiler &hot)
+{
+    TRACE_SCOPE("UpdateFrame");
+    HotSpotProbe probe(hot, cpu);
+    update_frame(probe);
+}
+
+template<typename Probe>
+void NES::update_frame(Probe &probe)
 {
     if (!IsRunning())
         return;
 
-    if (frame_ % AUDIO_DELAY_FRAME == 0)
-        PlaySamples();
+    cpu.ClearFrameStats();
+    probe.Start();
 
-    update_audio_speed();
+    if (audio_enabled_) {
+        if (frame_ % AUDIO_DELAY_FRAME == 0)
+            PlaySamples();
+
+        update_audio_speed();
+    }
+    probe.Lap(PHASE_AUDIO);
 
     for (;;) {
-        if (need_log()) {
-            PrintCpuStatus(cpu, ppu);
-            log_line_count_++;
+        if (DebugHooks::log && need_log())
+            log_instruction();
+
+        // run components. the CPU runs ahead until the next event or I/O
+        // access unless every instruction is needed
+        int cpu_cycles = 0;
+        if (cpu.IsSuspended()) {
+            cpu_cycles = dma.Run();
+            probe.Lap(PHASE_DMA);
+        }
+        else if (Probe::per_instruction || need_step()) {
+            probe.Fetch();
+            cpu_cycles = cpu.Run();
+            probe.Lap(PHASE_CPU);
+        }
+        else {
+            const uint64_t target = cpu.GetTotalCycles() + get_cycles_to_event();
+            cpu_cycles = cpu.RunUntil(target);
+            probe.Lap(PHASE_CPU);
         }
+        probe.Step(cpu_cycles);
 
-        // run components
-        const int cpu_cycles = cpu.IsSuspended() ? dma.Run() : cpu.Run();
         const bool frame_rendered = ppu.Run(cpu_cycles);
+        if (DebugHooks::latency && frame_rendered && latency_)
+            latency_->EndFrame();
+        probe.Lap(PHASE_PPU);
+
         apu.Run(cpu_cycles);
+        probe.Lap(PHASE_APU);
+
         cart_->Run(cpu_cycles);
+        probe.Lap(PHASE_CART);
 
         // break conditions
         const bool finish_update = handle_break_condition(frame_rendered);
+        probe.Lap(PHASE_OTHER);
         if (finish_update)
             break;
     }
 
-    if (frame_ % AUDIO_DELAY_FRAME == 0)
-        SendSamples();
+    if (audio_enabled_) {
+        if (frame_ % AUDIO_DELAY_FRAME == 0)
+            SendSamples();
+
+        update_audio_stats();
+    }
+    else {
+        // no audio device. drop samples generated in this frame
+        ClearSamples();
+    }
+    probe.Lap(PHASE_AUDIO);
 
     frame_++;
 }
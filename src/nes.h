@@ -9,7 +9,13 @@
 #include "framebuffer.h"
 #include "cartridge.h"
 #include "serialize.h"
+#include "profile.h"
+#include "hotspot.h"
+#include "exec_trace.h"
+#include "latency.h"
+#include "sound.h"
 #include <cstdint>
+#include <string>
 
 namespace nes {
 
@@ -44,11 +50,24 @@ public:
     void PushResetButton();
     void PlayGame();
     void StartLog();
+    // adds a record per instruction to the trace. nullptr to stop
+    void StartExecTrace(ExecTrace *trace);
+    // streams per frame timings to the file while playing
+    void SetMetricsCsv(const std::string &filename);
+    // measures input to photon latency of controller 1. nullptr to stop
+    void SetLatencyProbe(InputLatency *latency);
+    InputLatency *GetLatencyProbe() const { return latency_; }
 
     void UpdateFrame();
+    // same as UpdateFrame() and adds time spent in each component to prof
+    void UpdateFrame(FrameProfile &prof);
+    // same as UpdateFrame() and counts cycles per bank and PC in hot
+    void UpdateFrame(HotSpotProfiler &hot);
     void InputController(uint8_t id, uint8_t input);
 
     const Cartridge *GetCartridge() const { return cart_; }
+    // hash of the state saved by SaveState(). equal states give equal hashes
+    uint64_t HashState() const;
 
     void Run();
     void Pause();
@@ -59,12 +78,21 @@ public:
     uint64_t GetLogLineCount() const;
     void SetChannelEnable(uint64_t chan_bits);
     uint64_t GetChannelEnable() const;
+    // audio queue and speed factor of the last frame
+    const AudioFrameStats &GetAudioFrameStats() const { return audio_stats_; }
 
 private:
     Cartridge *cart_ = nullptr;
     uint64_t frame_ = 0;
+    bool audio_enabled_ = false;
+    bool audio_slow_ = false;
+    AudioFrameStats audio_stats_;
+    SoundStats sound_stats_;
     bool do_log_ = false;
     uint64_t log_line_count_ = 0;
+    ExecTrace *exec_trace_ = nullptr;
+    std::string metrics_csv_;
+    InputLatency *latency_ = nullptr;
 
     // state
     bool is_running_ = true;
@@ -84,9 +112,14 @@ private:
         SERIALIZE_NAMESPACE_END(ar);
     }
 
+    template<typename Probe> void update_frame(Probe &probe);
     void update_audio_speed();
+    void update_audio_stats();
     bool handle_break_condition(bool frame_rendered);
+    bool need_step() const;
+    int get_cycles_to_event() const;
     bool need_log() const;
+    void log_instruction();
     void print_disassemble() const;
 };
 
@@ -0,0 +1,148 @@
+#include "perf_counter.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace nes {
+
+const char *GetPerfEventName(int event)
+{
+    static const char *names[] = {
+        "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"
+    };
+    static_assert(sizeof(names) / sizeof(names[0]) == PERF_EVENT_COUNT,
+            "event names do not match PerfEvent");
+
+    if (event >= 0 && event < PERF_EVENT_COUNT)
+        return names[event];
+    else
+        return "";
+}
+
+PerfCounter::PerfCounter()
+{
+    fds_.fill(-1);
+    order_.fill(-1);
+}
+
+PerfCounter::~PerfCounter()
+{
+    Close();
+}
+
+bool PerfCounter::IsOpen() const
+{
+    return leader_fd_ != -1;
+}
+
+bool PerfCounter::IsAvailable(int event) const
+{
+    if (event >= 0 && event < PERF_EVENT_COUNT)
+        return fds_[event] != -1;
+    else
+        return false;
+}
+
+#if defined(__linux__)
+static int open_event(int event, int group_fd)
+{
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                            (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    };
+    static_assert(sizeof(events) / sizeof(events[0]) == PERF_EVENT_COUNT,
+            "events do not match PerfEvent");
+
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[event].type;
+    attr.config = events[event].config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    // this thread on any cpu
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+bool PerfCounter::Open()
+{
+    Close();
+
+    for (int event = 0; event < PERF_EVENT_COUNT; event++) {
+        const int fd = open_event(event, leader_fd_);
+        if (fd == -1)
+            continue;
+
+        if (leader_fd_ == -1)
+            leader_fd_ = fd;
+
+        fds_[event] = fd;
+        order_[count_++] = event;
+    }
+
+    if (!IsOpen())
+        return false;
+
+    ioctl(leader_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    return true;
+}
+
+void PerfCounter::Close()
+{
+    for (auto &fd: fds_) {
+        if (fd != -1)
+            close(fd);
+        fd = -1;
+    }
+
+    order_.fill(-1);
+    leader_fd_ = -1;
+    count_ = 0;
+}
+
+void PerfCounter::Read(PerfSample &sample) const
+{
+    // { nr, values[nr] }
+    uint64_t data[1 + PERF_EVENT_COUNT] = {0};
+
+    if (!IsOpen() || read(leader_fd_, data, sizeof(data)) <= 0)
+        return;
+
+    const int N = static_cast<int>(data[0]);
+    for (int i = 0; i < N && i < count_; i++)
+        sample.values[order_[i]] = data[1 + i];
+}
+#else
+bool PerfCounter::Open()
+{
+    return false;
+}
+
+void PerfCounter::Close()
+{
+}
+
+void PerfCounter::Read(PerfSample &sample) const
+{
+}
+#endif
+
+} // namespace
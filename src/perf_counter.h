@@ -0,0 +1,50 @@
+#ifndef PERF_COUNTER_H
+#define PERF_COUNTER_H
+
+#include <cstdint>
+#include <array>
+
+namespace nes {
+
+enum PerfEvent {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_EVENT_COUNT
+};
+
+struct PerfSample {
+    std::array<uint64_t,PERF_EVENT_COUNT> values = {0};
+};
+
+// Hardware performance counters of the calling thread in user space.
+// Uses perf_event_open on Linux. Open() fails on other platforms or when
+// the kernel or the VM does not expose the counters.
+class PerfCounter {
+public:
+    PerfCounter();
+    ~PerfCounter();
+
+    bool Open();
+    void Close();
+    bool IsOpen() const;
+    bool IsAvailable(int event) const;
+
+    // current totals. events not available read as 0
+    void Read(PerfSample &sample) const;
+
+private:
+    int leader_fd_ = -1;
+    std::array<int,PERF_EVENT_COUNT> fds_;
+    // event of each value in the group read
+    std::array<int,PERF_EVENT_COUNT> order_;
+    int count_ = 0;
+};
+
+const char *GetPerfEventName(int event);
+
+} // namespace
+
+#endif // _H
@@ -1,5 +1,8 @@
+#include <algorithm>
 #include "ppu.h"
 #include "cartridge.h"
+#include "heatmap.h"
+#include "hooks.h"
 
 namespace nes {
 
@@ -172,6 +175,9 @@ static Color get_color(int index)
 
 uint8_t PPU::read_byte(uint16_t addr) const
 {
+    if (DebugHooks::access && access_)
+        access_->Count(ACCESS_READ, addr);
+
     if (addr >= 0x0000 && addr <= 0x1FFF) {
         return cart_->ReadChr(addr);
     }
@@ -180,7 +186,7 @@ uint8_t PPU::read_byte(uint16_t addr) const
     }
     else if (addr >= 0x3000 && addr <= 0x3EFF) {
         // mirrors of 0x2000-0x2EFF
-        return read_byte(addr - 0x1000);
+        return cart_->ReadNameTable(addr - 0x1000);
     }
     else if (addr >= 0x3F00 && addr <= 0x3FFF) {
         const uint16_t a = 0x3F00 + (addr & 0x1F);
@@ -199,6 +205,9 @@ uint8_t PPU::read_byte(uint16_t addr) const
 
 void PPU::write_byte(uint16_t addr, uint8_t data)
 {
+    if (DebugHooks::access && access_)
+        access_->Count(ACCESS_WRITE, addr);
+
     if (addr >= 0x0000 && addr <= 0x1FFF) {
         cart_->WriteChr(addr, data);
     }
@@ -207,7 +216,7 @@ void PPU::write_byte(uint16_t addr, uint8_t data)
     }
     else if (addr >= 0x3000 && addr <= 0x3EFF) {
         // mirrors of 0x2000-0x2EFF
-        write_byte(addr - 0x1000, data);
+        cart_->WriteNameTable(addr - 0x1000, data);
     }
     else if (addr >= 0x3F00 && addr <= 0x3FFF) {
         // $3F20-$3FFF -> Mirrors of $3F00-$3F1F
@@ -852,7 +861,7 @@ void PPU::Clock()
         }
 
         // for debug
-        if (cycle_ == 0) {
+        if (DebugHooks::scroll && cycle_ == 0) {
             if (is_rendering_bg()) {
                 const VramPointer v = decode_address(temp_addr_);
                 scrolls_[scanline_] = {
@@ -928,16 +937,46 @@ void PPU::Reset()
     oam_.fill(0xFF);
 }
 
+static int dots_to(int dot, int event_dot)
+{
+    const int FRAME_DOTS = 262 * 341;
+
+    // to the event dot inclusive. a dot less in case an odd frame skips
+    // one on the way
+    const int dots = (event_dot - dot + FRAME_DOTS) % FRAME_DOTS + 1;
+    return std::max(dots - 1, 1);
+}
+
+int PPU::GetCyclesToEvent() const
+{
+    const int dot = scanline_ * 341 + cycle_;
+
+    // the frame ends at the last dot of the pre-render line
+    int dots = dots_to(dot, 261 * 341 + 340);
+
+    if (get_ctrl(CTRL_ENABLE_NMI))
+        dots = std::min(dots, dots_to(dot, 241 * 341 + 1));
+
+    // the mapper counts scanlines at dot 261
+    if (cart_->IsScanlineIRQEnabled()) {
+        const int next = cycle_ <= 261 ? scanline_ : (scanline_ + 1) % 262;
+        dots = std::min(dots, dots_to(dot, next * 341 + 261));
+    }
+
+    // 3 dots per CPU cycle
+    return (dots + 2) / 3;
+}
+
 bool PPU::Run(int cpu_cycles)
 {
     const int PPU_CYCLES = 3 * cpu_cycles;
-    const int scanline_before = scanline_;
+    const uint64_t frame_before = frame_;
 
     for (int i = 0; i < PPU_CYCLES; i++)
         Clock();
 
-    const int scanline_after = scanline_;
-    const bool frame_ready = scanline_before > scanline_after;
+    // the CPU may run up to a frame at once
+    const bool frame_ready = frame_ != frame_before;
 
     return frame_ready;
 }
@@ -1144,4 +1183,9 @@ Color PPU::GetPaletteColor(uint8_t palette_id, uint8_t value) const
     return get_color(index);
 }
 
+void PPU::SetAccessCounter(AccessCounter *counter)
+{
+    access_ = counter;
+}
+
 } // namespace
@@ -9,6 +9,7 @@
 namespace nes {
 
 class Cartridge;
+class AccessCounter;
 
 struct PatternRow {
     uint8_t tile_id = 0;
@@ -69,6 +70,9 @@ public:
     // clock
     bool Run(int cpu_cycles);
     void Clock();
+    // CPU cycles until Run() sets NMI, clocks the scanline IRQ of the
+    // mapper or finishes the frame. the event is in the last cycle
+    int GetCyclesToEvent() const;
     void PowerUp();
     void Reset();
 
@@ -104,9 +108,12 @@ public:
     Scroll GetScroll(int scanline) const;
     PpuStatus GetStatus() const;
     Color GetPaletteColor(uint8_t palette_id, uint8_t value) const;
+    // counts bus accesses while set. nullptr to stop
+    void SetAccessCounter(AccessCounter *counter);
 
 private:
     Cartridge *cart_ = nullptr;
+    AccessCounter *access_ = nullptr;
     FrameBuffer &fbuf_;
     int cycle_ = 0;
     int scanline_ = 0;
@@ -169,6 +176,27 @@ private:
         SERIALIZE_NAMESPACE_END(ar);
     }
 
+    friend void HashState(StateHash &h, const PPU *data)
+    {
+        HASH_STATE(h, data, cycle_);
+        HASH_STATE(h, data, scanline_);
+        HASH_STATE(h, data, frame_);
+        HASH_STATE(h, data, nmi_generated_);
+        HASH_STATE(h, data, ctrl_);
+        HASH_STATE(h, data, mask_);
+        HASH_STATE(h, data, stat_);
+        HASH_STATE(h, data, oam_dma_);
+        HASH_STATE(h, data, write_toggle_);
+        HASH_STATE(h, data, vram_addr_);
+        HASH_STATE(h, data, temp_addr_);
+        HASH_STATE(h, data, fine_x_);
+        HASH_STATE(h, data, read_buffer_);
+        HASH_STATE(h, data, palette_ram_);
+        HASH_STATE(h, data, nametable_);
+        HASH_STATE(h, data, oam_addr_);
+        HASH_STATE(h, data, oam_);
+    }
+
     // control
     void set_stat(uint8_t flag, bool val);
     bool get_ctrl(uint8_t flag) const;
@@ -0,0 +1,124 @@
+#include <cstdio>
+#include <chrono>
+#include "profile.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_RDTSC 1
+#else
+#define HAS_RDTSC 0
+#endif
+
+namespace nes {
+
+void FrameProfile::Clear()
+{
+    ticks.fill(0);
+    frames = 0;
+    cpu_cycles = 0;
+    events.fill(PerfSample());
+}
+
+const char *GetPhaseName(int phase)
+{
+    static const char *names[] = {
+        "cpu", "dma", "ppu", "apu", "cart", "audio", "other"
+    };
+    static_assert(sizeof(names) / sizeof(names[0]) == PHASE_COUNT,
+            "phase names do not match ProfilePhase");
+
+    if (phase >= 0 && phase < PHASE_COUNT)
+        return names[phase];
+    else
+        return "";
+}
+
+static uint64_t get_nanoseconds()
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+uint64_t GetProfileTicks()
+{
+#if HAS_RDTSC
+    return __rdtsc();
+#else
+    return get_nanoseconds();
+#endif
+}
+
+static double calibrate_ticks()
+{
+#if HAS_RDTSC
+    // count ticks over a short busy wait
+    const uint64_t ns0 = get_nanoseconds();
+    const uint64_t tsc0 = GetProfileTicks();
+    uint64_t ns1 = ns0;
+
+    while (ns1 - ns0 < 20 * 1000 * 1000)
+        ns1 = get_nanoseconds();
+
+    const uint64_t tsc1 = GetProfileTicks();
+    return (tsc1 - tsc0) * 1e9 / (ns1 - ns0);
+#else
+    return 1e9;
+#endif
+}
+
+double GetProfileTicksPerSecond()
+{
+    static const double ticks_per_sec = calibrate_ticks();
+    return ticks_per_sec;
+}
+
+void PrintFrameProfile(const FrameProfile &prof)
+{
+    if (prof.frames == 0)
+        return;
+
+    const double ns_per_tick = 1e9 / GetProfileTicksPerSecond();
+    const double frames = static_cast<double>(prof.frames);
+
+    uint64_t total_ticks = 0;
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+        total_ticks += prof.ticks[phase];
+
+    printf("%-8s %12s %7s", "phase", "ns/frame", "share");
+    if (prof.perf) {
+        printf(" %14s %14s %6s %14s %14s %14s",
+                "cycles/frame", "instr/frame", "IPC",
+                "br-miss/frame", "L1D-miss/frame", "LLC-miss/frame");
+    }
+    printf("\n");
+
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        printf("%-8s %12.0f %6.1f%%", GetPhaseName(phase),
+                prof.ticks[phase] * ns_per_tick / frames,
+                total_ticks ? 100. * prof.ticks[phase] / total_ticks : 0.);
+
+        if (prof.perf) {
+            const PerfSample &ev = prof.events[phase];
+            const double cycles = ev.values[PERF_CYCLES];
+            const double instructions = ev.values[PERF_INSTRUCTIONS];
+
+            printf(" %14.0f %14.0f %6.2f %14.0f %14.0f %14.0f",
+                    cycles / frames,
+                    instructions / frames,
+                    cycles > 0 ? instructions / cycles : 0.,
+                    ev.values[PERF_BRANCH_MISSES] / frames,
+                    ev.values[PERF_L1D_MISSES] / frames,
+                    ev.values[PERF_LLC_MISSES] / frames);
+        }
+        printf("\n");
+    }
+
+    if (prof.perf) {
+        for (int event = 0; event < PERF_EVENT_COUNT; event++) {
+            if (!prof.perf->IsAvailable(event))
+                printf("%s: not available\n", GetPerfEventName(event));
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,46 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <cstdint>
+#include <array>
+#include "perf_counter.h"
+
+namespace nes {
+
+// Phases of NES::UpdateFrame() measured by NES::UpdateFrame(FrameProfile &)
+enum ProfilePhase {
+    PHASE_CPU = 0,
+    PHASE_DMA,
+    PHASE_PPU,
+    PHASE_APU,
+    PHASE_CART,
+    PHASE_AUDIO,
+    PHASE_OTHER,
+    PHASE_COUNT
+};
+
+struct FrameProfile {
+    std::array<uint64_t,PHASE_COUNT> ticks = {0};
+    uint64_t frames = 0;
+    uint64_t cpu_cycles = 0;
+
+    // hardware counters per phase. counted only when perf is set,
+    // which makes the ticks above include the cost of reading them
+    const PerfCounter *perf = nullptr;
+    std::array<PerfSample,PHASE_COUNT> events;
+
+    void Clear();
+};
+
+// per phase table of time and hardware counters per frame
+void PrintFrameProfile(const FrameProfile &prof);
+
+const char *GetPhaseName(int phase);
+
+// Time stamp counter where available, otherwise nanoseconds
+uint64_t GetProfileTicks();
+double GetProfileTicksPerSecond();
+
+} // namespace
+
+#endif // _H
@@ -1,9 +1,19 @@
 #include <sstream>
 #include <iomanip>
+#include <limits>
 #include "property.h"
 
 namespace nes {
 
+// enough digits to read back the same value
+template<typename T>
+std::string to_float_string(T *real)
+{
+    std::ostringstream oss;
+    oss << std::setprecision(std::numeric_limits<T>::max_digits10) << *real;
+    return oss.str();
+}
+
 template<typename T>
 std::string to_hex_string(T *integer)
 {
@@ -60,10 +70,10 @@ std::string Property::ToString(int index) const
         return to_hex_string(p_bool + index);
 
     case DataType::Float:
-        return std::to_string(p_float[index]);
+        return to_float_string(p_float + index);
 
     case DataType::Double:
-        return std::to_string(p_double[index]);
+        return to_float_string(p_double + index);
 
     case DataType::String:
         return *p_string;
@@ -2,12 +2,14 @@
 #define SERIALIZE_H
 
 #include "property.h"
+#include "hash.h"
 #include <unordered_map>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <array>
 #include <map>
+#include <type_traits>
 
 namespace nes {
 
@@ -55,6 +57,35 @@ void Serialize(Archive &ar, const std::string &name, std::vector<uint8_t> *data)
 #define SERIALIZE_NAMESPACE_END(ar) (ar).LeaveNamespcae()
 #define SERIALIZE(ar, obj, member) Serialize((ar),#member,&(obj)->member)
 
+// State hashing goes over the same members as Serialize() without Archive.
+// Classes define HashState() next to Serialize() with the same members
+
+// for basic types
+template<typename T>
+void HashState(StateHash &h, const T *data)
+{
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value,
+            "HashState() is not defined for this type");
+    h.Add(*data);
+}
+
+// for array types
+template<typename T, size_t COUNT>
+void HashState(StateHash &h, const std::array<T, COUNT> *data)
+{
+    static_assert(std::is_arithmetic<T>::value, "array of non basic type");
+    h.AddBlock(data->data(), sizeof(T) * COUNT);
+}
+
+// for vector types
+inline
+void HashState(StateHash &h, const std::vector<uint8_t> *data)
+{
+    h.AddBlock(data->data(), data->size());
+}
+
+#define HASH_STATE(h, obj, member) HashState((h),&(obj)->member)
+
 } // namespace
 
 #endif // _H
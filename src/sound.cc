@@ -1,13 +1,15 @@
 #include <algorithm>
 #include <iostream>
+#include <array>
 #include <cstdint>
-#include <vector>
 #include <limits>
 
 #include <al.h>
 #include <alc.h>
 
 #include "sound.h"
+#include "profile.h"
+#include "trace.h"
 
 namespace nes {
 
@@ -22,7 +24,12 @@ static ALuint source = 0;
 static ALuint buffer_list[BUFFER_COUNT] = {0};
 static ALuint *pbuffer = buffer_list;
 
-static std::vector<int16_t> sample_data;
+// fixed size. samples over MAX_SAMPLE_COUNT before SendSamples() are dropped
+static std::array<int16_t,MAX_SAMPLE_COUNT> sample_data;
+static int sample_count = 0;
+static bool samples_dropped = false;
+
+static SoundStats stats;
 
 void InitSound()
 {
@@ -32,8 +39,6 @@ void InitSound()
 
     alGenBuffers(BUFFER_COUNT, buffer_list);
     alGenSources(1, &source);
-
-    sample_data.reserve(MAX_SAMPLE_COUNT);
 }
 
 void FinishSound()
@@ -47,7 +52,8 @@ void FinishSound()
     alcDestroyContext(context);
     alcCloseDevice(device);
 
-    sample_data.clear();
+    sample_count = 0;
+    stats = SoundStats();
 }
 
 static void unqueue_buffer()
@@ -79,6 +85,9 @@ static void switch_buffer()
 
 int GetQueuedSampleCount()
 {
+    TRACE_SCOPE("GetQueuedSampleCount");
+    const uint64_t start = GetProfileTicks();
+
     int queued = 0;
     int processed = 0;
     alGetSourcei(source, AL_BUFFERS_QUEUED, &queued);
@@ -86,11 +95,8 @@ int GetQueuedSampleCount()
 
     const int unplayed = queued - processed;
 
-    if (unplayed == 0) {
-        if (0)
-        printf("underflow!! queued: %d, processed: %d, unplayed: %d\n",
-                queued, processed, unplayed);
-    }
+    if (unplayed == 0)
+        stats.underrun_count++;
 
     int index = pbuffer - buffer_list;
     int total_count = 0;
@@ -108,14 +114,17 @@ int GetQueuedSampleCount()
     if (0)
         printf("total count: %d\n", total_count);
 
+    stats.queued_samples = total_count;
+    stats.al_ticks += GetProfileTicks() - start;
+
     return total_count;
 }
 
-static void queue_buffer(const std::vector<int16_t> &buff)
+static void queue_buffer(const int16_t *buff, int count)
 {
     // copy sample buff
     alBufferData(*pbuffer, AL_FORMAT_MONO16,
-            buff.data(), buff.size() * sizeof(buff[0]), SAMPLING_RATE);
+            buff, count * sizeof(buff[0]), SAMPLING_RATE);
 
     // queue buffer
     alSourceQueueBuffers(source, 1, pbuffer);
@@ -125,23 +134,44 @@ static void queue_buffer(const std::vector<int16_t> &buff)
 
 void PushSample(float sample)
 {
+    if (sample_count == MAX_SAMPLE_COUNT) {
+        samples_dropped = true;
+        return;
+    }
+
     const int value = std::numeric_limits<int16_t>::max() * sample;
-    sample_data.push_back(value);
+    sample_data[sample_count++] = value;
 }
 
 void SendSamples()
 {
+    TRACE_SCOPE("SendSamples");
+
     if (0)
-        printf("samples: %lu\n", sample_data.size());
+        printf("samples: %d\n", sample_count);
+
+    const uint64_t start = GetProfileTicks();
 
     unqueue_buffer();
-    queue_buffer(sample_data);
 
-    sample_data.clear();
+    // the next buffer is still waiting to be played
+    ALint queued_count = 0;
+    alGetSourcei(source, AL_BUFFERS_QUEUED, &queued_count);
+    if (queued_count == BUFFER_COUNT || samples_dropped)
+        stats.overrun_count++;
+
+    queue_buffer(sample_data.data(), sample_count);
+
+    stats.al_ticks += GetProfileTicks() - start;
+    sample_count = 0;
+    samples_dropped = false;
 }
 
 void PlaySamples()
 {
+    TRACE_SCOPE("PlaySamples");
+    const uint64_t start = GetProfileTicks();
+
     ALint queued_count = 0;
     ALint stat = 0;
 
@@ -154,6 +184,8 @@ void PlaySamples()
         if (0)
             printf("Sound Play: Queued Count: %d\n", queued_count);
     }
+
+    stats.al_ticks += GetProfileTicks() - start;
 }
 
 void PauseSamples()
@@ -161,4 +193,15 @@ void PauseSamples()
     alSourcePause(source);
 }
 
+void ClearSamples()
+{
+    sample_count = 0;
+    samples_dropped = false;
+}
+
+void GetSoundStats(SoundStats &s)
+{
+    s = stats;
+}
+
 } // namespace
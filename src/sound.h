@@ -1,8 +1,32 @@
 #ifndef SOUND_H
 #define SOUND_H
 
+#include <cstdint>
+
 namespace nes {
 
+// Totals since InitSound(). All zero without audio device
+struct SoundStats {
+    // unplayed samples at the last GetQueuedSampleCount()
+    int queued_samples = 0;
+    // GetQueuedSampleCount() found nothing left to play
+    uint64_t underrun_count = 0;
+    // SendSamples() found every buffer queued or samples were dropped
+    uint64_t overrun_count = 0;
+    // GetProfileTicks() spent in OpenAL calls
+    uint64_t al_ticks = 0;
+};
+
+// Audio of one frame from SoundStats and the speed factor of NES
+struct AudioFrameStats {
+    int queued_samples = 0;
+    int underruns = 0;
+    int overruns = 0;
+    uint64_t al_ticks = 0;
+    float speed_factor = 1.f;
+    bool speed_changed = false;
+};
+
 extern void InitSound();
 extern void FinishSound();
 
@@ -10,8 +34,10 @@ extern void PushSample(float sample);
 extern void SendSamples();
 extern void PlaySamples();
 extern void PauseSamples();
+extern void ClearSamples();
 
 int GetQueuedSampleCount();
+void GetSoundStats(SoundStats &stats);
 
 } // namespace
 
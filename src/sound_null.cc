@@ -0,0 +1,46 @@
+#include "sound.h"
+
+namespace nes {
+
+// Sound backend for headless builds. No audio device is opened and
+// all samples generated by APU are thrown away.
+
+void InitSound()
+{
+}
+
+void FinishSound()
+{
+}
+
+void PushSample(float sample)
+{
+}
+
+void SendSamples()
+{
+}
+
+void PlaySamples()
+{
+}
+
+void PauseSamples()
+{
+}
+
+void ClearSamples()
+{
+}
+
+int GetQueuedSampleCount()
+{
+    return 0;
+}
+
+void GetSoundStats(SoundStats &stats)
+{
+    stats = SoundStats();
+}
+
+} // namespace
@@ -1,12 +1,15 @@
 #include "state.h"
 #include "serialize.h"
 #include "nes.h"
+#include "trace.h"
 #include <fstream>
 
 namespace nes {
 
 bool SaveState(NES &nes, const std::string &filename)
 {
+    TRACE_SCOPE("SaveState");
+
     std::ofstream ofs(filename);
     if (!ofs)
         return false;
@@ -21,6 +24,8 @@ bool SaveState(NES &nes, const std::string &filename)
 
 bool LoadState(NES &nes, const std::string &filename)
 {
+    TRACE_SCOPE("LoadState");
+
     std::ifstream ifs(filename);
     if (!ifs)
         return false;
@@ -30,6 +35,9 @@ bool LoadState(NES &nes, const std::string &filename)
     Serialize(ar, "nes", &nes);
     ar.Read(ifs);
 
+    // banks and flags were restored behind the CPU
+    nes.cpu.RestoreState();
+
     return true;
 }
 
@@ -0,0 +1,134 @@
+#include "trace.h"
+
+#if NES_TRACE
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace nes {
+
+#if NES_TRACE
+// events kept per thread. older ones are overwritten
+static constexpr size_t TRACE_BUFFER_SIZE = 1 << 18;
+
+struct TraceEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+};
+
+struct TraceBuffer {
+    std::vector<TraceEvent> events;
+    uint64_t count = 0;
+    int tid = 0;
+};
+
+static std::atomic<bool> tracing(false);
+static std::mutex trace_mutex;
+static std::vector<std::unique_ptr<TraceBuffer>> trace_buffers;
+static std::string trace_filename;
+static uint64_t trace_start = 0;
+
+static thread_local TraceBuffer *local_buffer = nullptr;
+
+static TraceBuffer *new_buffer()
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    std::unique_ptr<TraceBuffer> buf(new TraceBuffer);
+    buf->events.resize(TRACE_BUFFER_SIZE);
+    buf->tid = static_cast<int>(trace_buffers.size()) + 1;
+
+    trace_buffers.push_back(std::move(buf));
+    return trace_buffers.back().get();
+}
+
+void AddTraceEvent(const char *name, uint64_t start, uint64_t end)
+{
+    if (!tracing.load(std::memory_order_relaxed))
+        return;
+
+    if (!local_buffer)
+        local_buffer = new_buffer();
+
+    TraceBuffer &buf = *local_buffer;
+    buf.events[buf.count % TRACE_BUFFER_SIZE] = {name, start, end};
+    buf.count++;
+}
+
+bool StartTrace(const std::string &filename)
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    for (auto &buf: trace_buffers)
+        buf->count = 0;
+
+    trace_filename = filename;
+    trace_start = GetProfileTicks();
+    tracing = true;
+
+    return true;
+}
+
+bool FinishTrace()
+{
+    if (!tracing)
+        return false;
+
+    tracing = false;
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    std::ofstream ofs(trace_filename);
+    if (!ofs)
+        return false;
+
+    const double us_per_tick = 1e6 / GetProfileTicksPerSecond();
+    const char *separator = "";
+    char line[256] = {'\0'};
+
+    ofs << "{\"traceEvents\":[\n";
+
+    for (const auto &buf: trace_buffers) {
+        const uint64_t N = std::min<uint64_t>(buf->count, TRACE_BUFFER_SIZE);
+        const uint64_t first = buf->count - N;
+
+        for (uint64_t i = first; i < buf->count; i++) {
+            const TraceEvent &ev = buf->events[i % TRACE_BUFFER_SIZE];
+            if (ev.start < trace_start)
+                continue;
+
+            snprintf(line, sizeof(line),
+                    "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"pid\":1,\"tid\":%d}",
+                    separator, ev.name,
+                    (ev.start - trace_start) * us_per_tick,
+                    (ev.end - ev.start) * us_per_tick,
+                    buf->tid);
+            ofs << line;
+            separator = ",\n";
+        }
+    }
+
+    ofs << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return true;
+}
+#else
+bool StartTrace(const std::string &filename)
+{
+    return false;
+}
+
+bool FinishTrace()
+{
+    return false;
+}
+#endif
+
+} // namespace
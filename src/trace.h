@@ -0,0 +1,50 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+#include "profile.h"
+
+// Timeline of host-side work written as Chrome trace JSON, which can be
+// opened in chrome://tracing or ui.perfetto.dev.
+//
+// Build with TRACE=1 (make headless TRACE=1) to record TRACE_SCOPE()s.
+// TRACE=2 also records every CPU/DMA/PPU/APU/cartridge step, which fills
+// the ring buffer within a few frames. With TRACE=0 the macros expand to
+// nothing.
+#ifndef NES_TRACE
+#define NES_TRACE 0
+#endif
+
+namespace nes {
+
+// records events from now on. false if tracing is not built in
+bool StartTrace(const std::string &filename);
+// writes the events left in the ring buffers
+bool FinishTrace();
+
+#if NES_TRACE
+void AddTraceEvent(const char *name, uint64_t start, uint64_t end);
+
+class TraceScope {
+public:
+    TraceScope(const char *name) : name_(name), start_(GetProfileTicks()) {}
+    ~TraceScope() { AddTraceEvent(name_, start_, GetProfileTicks()); }
+
+private:
+    const char *name_;
+    uint64_t start_;
+};
+#endif
+
+} // namespace
+
+#if NES_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) nes::TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
+
+#endif // _H
@@ -0,0 +1,248 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "nes.h"
+#include "cartridge.h"
+#include "exec_trace.h"
+#include "hooks.h"
+#include "synth_rom.h"
+
+using namespace nes;
+
+// Runs the synthetic ROM of every mapper batched with each CPU engine and
+// stepped one instruction at a time, and compares the state after each
+// frame. An exec trace ring makes NES::UpdateFrame() step.
+//
+// The batches end at NES::get_cycles_to_event(). A wrong deadline for the
+// NMI, the APU frame IRQ or the MMC3, VRC and N163 IRQs shows up here.
+//
+// With nestest.nes and nestest.log, also runs nestest from $C000 in CPU
+// batches of varied sizes with each engine, the JIT compiling every block
+// on its first run. The registers where a batch ends must match the log
+// line at that cycle.
+
+static constexpr int FRAMES = 60;
+
+enum RunMode {
+    RUN_BLOCK = 0,
+    RUN_INTERPRETER,
+    RUN_JIT,
+    RUN_STEP,
+    RUN_MODE_COUNT,
+};
+
+static const char *get_mode_name(int mode)
+{
+    switch (mode) {
+    case RUN_BLOCK:       return "block";
+    case RUN_INTERPRETER: return "interpreter";
+    case RUN_JIT:         return "jit";
+    case RUN_STEP:        return "step";
+    default:              return "";
+    }
+}
+
+// state hash after every frame
+static bool run_rom(const std::vector<uint8_t> &rom, int mode, std::vector<uint64_t> &hashes)
+{
+    Cartridge cart;
+    std::istringstream iss(std::string(rom.begin(), rom.end()));
+    if (!cart.Open(iss) || !cart.IsMapperSupported())
+        return false;
+
+    NES nes;
+    nes.InsertCartridge(&cart);
+    nes.cpu.SetEngine(mode == RUN_BLOCK ? CPU_ENGINE_BLOCK :
+                      mode == RUN_JIT ? CPU_ENGINE_JIT : CPU_ENGINE_INTERPRETER);
+    nes.PowerUp();
+
+    ExecTrace trace;
+    if (mode == RUN_STEP) {
+        trace.OpenRing(ExecTrace::CHUNK_SIZE);
+        nes.StartExecTrace(&trace);
+    }
+
+    hashes.clear();
+    for (int i = 0; i < FRAMES; i++) {
+        nes.UpdateFrame();
+        hashes.push_back(nes.HashState());
+    }
+
+    return true;
+}
+
+struct LogLine {
+    uint64_t cycle = 0;
+    CpuStatus stat;
+};
+
+// "C000  4C F5 C5  JMP $C5F5    A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 21 CYC:7"
+static bool load_nestest_log(const char *filename, std::vector<LogLine> &lines)
+{
+    std::ifstream ifs(filename);
+    if (!ifs)
+        return false;
+
+    // the lines of the official opcodes. nes-headless --test-mode
+    const size_t LINE_COUNT = 8980;
+
+    std::string text;
+    while (lines.size() < LINE_COUNT && std::getline(ifs, text)) {
+        const size_t regs = text.find("A:");
+        const size_t cyc = text.find("CYC:");
+        if (regs == std::string::npos || cyc == std::string::npos)
+            return false;
+
+        unsigned int pc, a, x, y, p, s;
+        unsigned long long cycle;
+        if (sscanf(text.c_str(), "%x", &pc) != 1 ||
+            sscanf(text.c_str() + regs, "A:%x X:%x Y:%x P:%x SP:%x", &a, &x, &y, &p, &s) != 5 ||
+            sscanf(text.c_str() + cyc, "CYC:%llu", &cycle) != 1)
+            return false;
+
+        LogLine line;
+        line.cycle = cycle;
+        line.stat.pc = pc;
+        line.stat.a = a;
+        line.stat.x = x;
+        line.stat.y = y;
+        line.stat.p = p;
+        line.stat.s = s;
+        lines.push_back(line);
+    }
+
+    return !lines.empty();
+}
+
+static bool is_same_status(const CpuStatus &a, const CpuStatus &b)
+{
+    return a.pc == b.pc && a.a == b.a && a.x == b.x && a.y == b.y &&
+           a.p == b.p && a.s == b.s;
+}
+
+// nestest from $C000 with only the CPU run. returns the batches checked
+static int check_nestest(Cartridge &cart, const std::vector<LogLine> &lines, CpuEngine engine)
+{
+    NES nes;
+    nes.InsertCartridge(&cart);
+    nes.cpu.SetEngine(engine);
+    nes.cpu.SetJitThreshold(1);
+    nes.PowerUp();
+    nes.cpu.SetPC(0xC000);
+
+    int batch_count = 0;
+
+    for (int i = 0; nes.cpu.GetTotalCycles() < lines.back().cycle; i++) {
+        // 16 to 215 cycles. some blocks run native, some near the end
+        // of a batch interpreted
+        nes.cpu.RunUntil(nes.cpu.GetTotalCycles() + 16 + (i * 37) % 200);
+
+        const uint64_t cycle = nes.cpu.GetTotalCycles();
+        if (cycle > lines.back().cycle)
+            break;
+
+        const auto it = std::lower_bound(lines.begin(), lines.end(), cycle,
+                [](const LogLine &line, uint64_t c) { return line.cycle < c; });
+        const CpuStatus stat = nes.cpu.GetStatus();
+
+        if (it == lines.end() || it->cycle != cycle || !is_same_status(stat, it->stat)) {
+            printf("nestest: %llu cycles: PC:%04X A:%02X X:%02X Y:%02X P:%02X SP:%02X",
+                    static_cast<unsigned long long>(cycle),
+                    stat.pc, stat.a, stat.x, stat.y, stat.p, stat.s);
+            if (it != lines.end() && it->cycle == cycle)
+                printf(", log PC:%04X A:%02X X:%02X Y:%02X P:%02X SP:%02X",
+                        it->stat.pc, it->stat.a, it->stat.x, it->stat.y, it->stat.p, it->stat.s);
+            else
+                printf(", no log line");
+            printf("\n");
+            return 0;
+        }
+
+        batch_count++;
+    }
+
+    // error codes of the tests
+    if (nes.cpu.PeekData(0x02) != 0x00 || nes.cpu.PeekData(0x03) != 0x00) {
+        printf("nestest: error %02X %02X\n", nes.cpu.PeekData(0x02), nes.cpu.PeekData(0x03));
+        return 0;
+    }
+
+    return batch_count;
+}
+
+int main(int argc, char **argv)
+{
+    if (!DebugHooks::log) {
+        std::cerr << "stepping needs the exec trace. rebuild with HOOKS=1" << std::endl;
+        return 1;
+    }
+
+    int fail_count = 0;
+
+    if (argc == 3) {
+        Cartridge cart;
+        std::vector<LogLine> lines;
+        if (!cart.Open(argv[1]) || !load_nestest_log(argv[2], lines)) {
+            std::cerr << "could not open " << argv[1] << " and " << argv[2] << std::endl;
+            return 1;
+        }
+
+        const struct {
+            CpuEngine engine;
+            const char *name;
+        } engines[] = {
+            {CPU_ENGINE_INTERPRETER, "interpreter"},
+            {CPU_ENGINE_BLOCK, "block"},
+            {CPU_ENGINE_JIT, "jit"}
+        };
+
+        for (const auto &e: engines) {
+            const int batch_count = check_nestest(cart, lines, e.engine);
+            if (batch_count > 0)
+                printf("nestest: %s: %d batches match\n", e.name, batch_count);
+            else
+                fail_count++;
+        }
+    }
+
+    for (const int mapper_id: SYNTH_MAPPERS) {
+        const std::vector<uint8_t> rom = MakeSynthRom(mapper_id);
+
+        std::vector<uint64_t> hashes[RUN_MODE_COUNT];
+        bool ok = true;
+
+        for (int mode = 0; mode < RUN_MODE_COUNT && ok; mode++) {
+            if (!run_rom(rom, mode, hashes[mode])) {
+                printf("mapper %3d: could not open\n", mapper_id);
+                ok = false;
+            }
+        }
+
+        for (int mode = 0; mode < RUN_STEP && ok; mode++) {
+            for (int i = 0; i < FRAMES; i++) {
+                if (hashes[mode][i] == hashes[RUN_STEP][i])
+                    continue;
+
+                printf("mapper %3d: frame %d: %s %016llx, step %016llx\n",
+                        mapper_id, i + 1, get_mode_name(mode),
+                        static_cast<unsigned long long>(hashes[mode][i]),
+                        static_cast<unsigned long long>(hashes[RUN_STEP][i]));
+                ok = false;
+                break;
+            }
+        }
+
+        if (ok) {
+            printf("mapper %3d: %d frames match\n", mapper_id, FRAMES);
+        }
+        else {
+            fail_count++;
+        }
+    }
+
+    return fail_count > 0 ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "nes.h"
+#include "cartridge.h"
+#include "synth_rom.h"
+
+using namespace nes;
+
+// Runs the synthetic ROM whose code ends at $FFFF with each CPU engine.
+// The block engine and the JIT decode the last page of PRG ROM up to its
+// last byte.
+// Built with -fsanitize=address, so a read past it aborts the test.
+
+static constexpr int FRAMES = 10;
+static constexpr uint16_t COUNTER = 0x0010;
+
+struct RunResult {
+    uint64_t hash = 0;
+    int counter = 0;
+};
+
+static bool run_rom(const std::vector<uint8_t> &rom, CpuEngine engine, RunResult &result)
+{
+    Cartridge cart;
+    std::istringstream iss(std::string(rom.begin(), rom.end()));
+    if (!cart.Open(iss) || !cart.IsMapperSupported())
+        return false;
+
+    NES nes;
+    nes.InsertCartridge(&cart);
+    nes.cpu.SetEngine(engine);
+    nes.PowerUp();
+
+    for (int i = 0; i < FRAMES; i++)
+        nes.UpdateFrame();
+
+    result.hash = nes.HashState();
+    result.counter = nes.cpu.PeekData(COUNTER) | (nes.cpu.PeekData(COUNTER + 1) << 8);
+    return true;
+}
+
+int main()
+{
+    const std::vector<uint8_t> rom = MakePageEndRom();
+
+    RunResult block, interp, jit;
+    if (!run_rom(rom, CPU_ENGINE_BLOCK, block) ||
+        !run_rom(rom, CPU_ENGINE_INTERPRETER, interp) ||
+        !run_rom(rom, CPU_ENGINE_JIT, jit)) {
+        std::cerr << "page end ROM: could not open" << std::endl;
+        return 1;
+    }
+
+    printf("page end ROM: block %016llx, interpreter %016llx, jit %016llx, %d loops\n",
+            static_cast<unsigned long long>(block.hash),
+            static_cast<unsigned long long>(interp.hash),
+            static_cast<unsigned long long>(jit.hash), block.counter);
+
+    if (block.counter == 0) {
+        std::cerr << "page end ROM: the loop did not run" << std::endl;
+        return 1;
+    }
+
+    if (block.hash != interp.hash || jit.hash != interp.hash) {
+        std::cerr << "page end ROM: the engines differ" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
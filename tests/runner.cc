@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "nes.h"
+#include "cartridge.h"
+
+using namespace nes;
+
+// Runs test ROMs headless, one emulator per ROM on a pool of threads.
+//
+// A ROM is done when it reports a result with the $6000 protocol used by
+// blargg's tests:
+//   $6001-$6003 DE B0 61 signature
+//   $6000       $80 running, $81 push reset after 100ms, else result code
+//   $6004-      zero terminated text
+// ROMs without the signature are done when the screen stays the same for
+// a number of frames. Those are reported as DONE with the frame hash.
+
+enum TestStatus {
+    TEST_PASS = 0,
+    TEST_FAIL,
+    TEST_DONE,
+    TEST_TIMEOUT,
+    TEST_ERROR,
+};
+
+struct TestResult {
+    std::string filename;
+    TestStatus status = TEST_ERROR;
+    int code = 0;
+    std::string message;
+    uint64_t frames = 0;
+    uint64_t frame_hash = 0;
+    double seconds = 0;
+};
+
+struct TestOption {
+    uint64_t timeout_frames = 60 * 120;
+    uint64_t stable_frames = 60 * 10;
+};
+
+static const char *get_status_name(TestStatus status)
+{
+    switch (status) {
+    case TEST_PASS:    return "PASS";
+    case TEST_FAIL:    return "FAIL";
+    case TEST_DONE:    return "DONE";
+    case TEST_TIMEOUT: return "TIMEOUT";
+    case TEST_ERROR:   return "ERROR";
+    default:           return "";
+    }
+}
+
+static bool has_signature(const CPU &cpu)
+{
+    return cpu.PeekData(0x6001) == 0xDE &&
+           cpu.PeekData(0x6002) == 0xB0 &&
+           cpu.PeekData(0x6003) == 0x61;
+}
+
+static std::string get_text(const CPU &cpu)
+{
+    std::string text;
+
+    for (int addr = 0x6004; addr < 0x8000; addr++) {
+        const char ch = cpu.PeekData(addr);
+        if (ch == '\0')
+            break;
+        text += ch;
+    }
+
+    // first non-empty line is enough for the report
+    const size_t begin = text.find_first_not_of("\n ");
+    if (begin == std::string::npos)
+        return "";
+    const size_t end = text.find('\n', begin);
+
+    return text.substr(begin, end == std::string::npos ? end : end - begin);
+}
+
+static void run_test(const TestOption &opt, TestResult &result)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    Cartridge cart;
+    if (!cart.Open(result.filename.c_str())) {
+        result.message = "not a *.nes file";
+        return;
+    }
+    if (!cart.IsMapperSupported()) {
+        result.message = "mapper " + std::to_string(cart.GetMapperID()) + " is not supported";
+        return;
+    }
+
+    NES nes;
+    nes.InsertCartridge(&cart);
+    nes.PowerUp();
+
+    const int RESET_DELAY = 6;
+    int reset_countdown = 0;
+    uint64_t last_hash = 0;
+    uint64_t stable_count = 0;
+
+    result.status = TEST_TIMEOUT;
+
+    for (uint64_t frame = 0; frame < opt.timeout_frames; frame++) {
+        nes.UpdateFrame();
+        result.frames = frame + 1;
+
+        if (has_signature(nes.cpu)) {
+            const uint8_t code = nes.cpu.PeekData(0x6000);
+
+            if (code == 0x80) {
+                continue;
+            }
+            else if (code == 0x81) {
+                if (reset_countdown == 0)
+                    reset_countdown = RESET_DELAY;
+                else if (--reset_countdown == 0)
+                    nes.PushResetButton();
+                continue;
+            }
+            else {
+                result.status = code == 0x00 ? TEST_PASS : TEST_FAIL;
+                result.code = code;
+                result.message = get_text(nes.cpu);
+                break;
+            }
+        }
+
+        const uint64_t hash = nes.fbuf.GetHash();
+        stable_count = hash == last_hash ? stable_count + 1 : 0;
+        last_hash = hash;
+
+        if (stable_count == opt.stable_frames) {
+            result.status = TEST_DONE;
+            break;
+        }
+    }
+
+    result.frame_hash = nes.fbuf.GetHash();
+    nes.ShutDown();
+
+    const auto end = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+}
+
+static bool has_suffix(const std::string &str, const std::string &suffix)
+{
+    return str.size() >= suffix.size() &&
+        str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static void find_roms(const std::string &path, std::vector<std::string> &filenames)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return;
+
+    if (!S_ISDIR(st.st_mode)) {
+        filenames.push_back(path);
+        return;
+    }
+
+    DIR *dir = opendir(path.c_str());
+    if (!dir)
+        return;
+
+    std::vector<std::string> entries;
+    while (const struct dirent *ent = readdir(dir)) {
+        const std::string name = ent->d_name;
+        if (name[0] != '.')
+            entries.push_back(name);
+    }
+    closedir(dir);
+
+    std::sort(entries.begin(), entries.end());
+
+    for (const auto &name: entries) {
+        const std::string child = path + "/" + name;
+
+        if (stat(child.c_str(), &st) != 0)
+            continue;
+
+        if (S_ISDIR(st.st_mode))
+            find_roms(child, filenames);
+        else if (has_suffix(name, ".nes"))
+            filenames.push_back(child);
+    }
+}
+
+static void print_result(const TestResult &r)
+{
+    printf("%-7s %7.2fs %6llu frames  %s", get_status_name(r.status), r.seconds,
+            static_cast<unsigned long long>(r.frames), r.filename.c_str());
+
+    if (r.status == TEST_FAIL)
+        printf("  #%d", r.code);
+    if (r.status == TEST_DONE || r.status == TEST_TIMEOUT)
+        printf("  %016llx", static_cast<unsigned long long>(r.frame_hash));
+    if (!r.message.empty())
+        printf("  %s", r.message.c_str());
+
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    TestOption opt;
+    int jobs = std::max<int>(std::thread::hardware_concurrency(), 1);
+    std::vector<std::string> filenames;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if (arg == "--jobs" && i + 1 < argc) {
+            jobs = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (arg == "--timeout" && i + 1 < argc) {
+            opt.timeout_frames = 60 * std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--stable-frames" && i + 1 < argc) {
+            opt.stable_frames = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg[0] != '-') {
+            find_roms(arg, filenames);
+        }
+        else {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    if (filenames.empty()) {
+        std::cerr << "no test roms" << std::endl;
+        return -1;
+    }
+
+    std::vector<TestResult> results(filenames.size());
+    for (size_t i = 0; i < filenames.size(); i++)
+        results[i].filename = filenames[i];
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // each worker takes the next rom until none is left
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    jobs = std::min<int>(jobs, results.size());
+
+    for (int i = 0; i < jobs; i++) {
+        workers.emplace_back([&]() {
+            for (size_t index = next++; index < results.size(); index = next++)
+                run_test(opt, results[index]);
+        });
+    }
+    for (auto &worker: workers)
+        worker.join();
+
+    const auto end = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+
+    int counts[TEST_ERROR + 1] = {0};
+    for (const auto &r: results) {
+        print_result(r);
+        counts[r.status]++;
+    }
+
+    printf("\n%d passed, %d failed, %d done, %d timed out, %d errors in %.2f sec (%d jobs)\n",
+            counts[TEST_PASS], counts[TEST_FAIL], counts[TEST_DONE],
+            counts[TEST_TIMEOUT], counts[TEST_ERROR], elapsed, jobs);
+
+    return counts[TEST_FAIL] + counts[TEST_TIMEOUT] + counts[TEST_ERROR] > 0 ? 1 : 0;
+}